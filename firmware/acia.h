@@ -5,7 +5,11 @@ extern void acia_init();
 extern void __fastcall__ acia_putc(char c);
 extern void __fastcall__ acia_puts(const char * s);
 extern void acia_put_newline();
+extern void __fastcall__ acia_buffer_putc(char c);
+extern void acia_flush();
 extern char acia_getc();
+extern int acia_getc_nowait();
+extern int acia_getc_timeout();
 extern void __fastcall__ acia_gets(char * buffer, unsigned char n);
 
 #endif
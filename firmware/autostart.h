@@ -0,0 +1,17 @@
+#ifndef _AUTOSTART_H
+#define _AUTOSTART_H
+
+// One program line of the ROM program (see bas2rom.rb)
+typedef struct _autostart_line {
+  unsigned int number;
+  unsigned char command;
+  const char *args;
+} autostart_line;
+
+// Program lines sorted by number, terminated by a line with args == 0
+extern const autostart_line autostart_program[];
+
+// True if the ROM program should be run after reset
+extern const unsigned char autostart_run;
+
+#endif
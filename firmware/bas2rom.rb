@@ -0,0 +1,79 @@
+#!/bin/env ruby
+# encoding: UTF-8
+
+# Convert a BASIC program into a C source file with the program lines in the
+# interpreter's internal format (line number, command index, encoded arguments).
+# The command indices are taken from the keyword table in basic.c.
+#
+# Usage: bas2rom.rb <basic.c> [<program.bas> [autorun]]
+
+require_relative '../terminal/baspack'
+
+basic_c, program_file, autorun = ARGV
+
+keywords = BasicPacker.keywords basic_c
+
+def c_string s
+  escaped = s.bytes.map do |b|
+    if b == '"'.ord || b == '\\'.ord
+      "\\#{b.chr}"
+    elsif b >= 32 && b < 127
+      b.chr
+    else
+      sprintf('\\%03o', b)
+    end
+  end
+  '"' + escaped.join + '"'
+end
+
+lines = {}
+if program_file
+  File.readlines(program_file).each_with_index do |line, index|
+    line = line.chomp
+    next if line.strip.empty?
+    unless line =~ /^(\d+) +(.*)$/
+      abort "#{program_file}:#{index + 1}: Missing line number"
+    end
+    number, text = $1.to_i, $2
+    encoded = []
+    first_command = nil
+    statements = BasicPacker.split_statements text
+    statements.each_with_index do |statement, statement_index|
+      statement = statement.lstrip
+      command = keywords.index BasicPacker.keyword_of(keywords, statement)
+      abort "#{program_file}:#{index + 1}: Unknown command" unless command
+      if keywords[command] == 'rem'
+        statement = statements[statement_index..-1].join(':').lstrip
+        last = true
+      else
+        last = statement_index == statements.size - 1
+      end
+      args = statement.sub(/^[^ ]*/, '').lstrip
+      args = args.rstrip unless last
+      # Jump table slot of ON (see cmd_on() in basic.c)
+      args = "\x80" + args if keywords[command] == 'on'
+      if first_command
+        encoded << command.chr + args
+      else
+        first_command = command
+        encoded << args
+      end
+      break if last
+    end
+    # <args> \0 { <command> <args> \0 } 0xFF, see execute_line() in basic.c
+    lines[number] = [first_command, encoded.map { |s| s + "\0" }.join + "\xff"]
+  end
+end
+
+puts '// Generated by bas2rom.rb, do not edit'
+puts '#include "autostart.h"'
+puts
+puts 'const autostart_line autostart_program[] = {'
+lines.keys.sort.each do |number|
+  command, args = lines[number]
+  puts "  { #{number}, #{command}, #{c_string args} },"
+end
+puts '  { 0, 0, 0 }'
+puts '};'
+puts
+puts "const unsigned char autostart_run = #{autorun ? 1 : 0};"
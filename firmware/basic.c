@@ -14,8 +14,32 @@
 #include "utils.h"
 #include "basic.h"
 #include "debug.h"
+#include "memory.h"
+#include "pool.h"
+#include "lexer.h"
+#include "fastmath.h"
+#include "autostart.h"
+#include "profile.h"
+#include "compiler.h"
+#include "xmodem.h"
+#include "overlay.h"
+#include "console.h"
+#include "screen.h"
+#include "data.h"
+#include "replay.h"
 
 void execute(char *s);
+unsigned char execute_statement(char *s);
+void execute_line();
+void start_program();
+void stop_program();
+void run_lines();
+void debug_lines(unsigned char step, unsigned char resume);
+void continue_program(unsigned char step);
+void reset_tasks();
+void schedule_tasks();
+char *find_statement_end(char *s);
+unsigned int line_args_size(char *args);
 void print_ready();
 void print_interrupted();
 
@@ -24,9 +48,10 @@ char *parse_number_term(char *s, int *value);
 char *parse_integer(char *s, int *value);
 char *parse_string_expression(char *s, char **value);
 char *parse_string(char *s, char *value);
+char *copy_string_token(char *value);
 char *parse_variable(char *s, unsigned int *name, unsigned char *type);
-unsigned char next_token(char *s);
 char *consume_token(char *s, unsigned char token);
+char *parse_number_list(char *s, int *values, unsigned char count);
 char * skip_whitespace(char *s);
 char * find_args(char *s);
 unsigned char find_keyword(char *s);
@@ -38,6 +63,7 @@ void syntax_error_invalid_token(unsigned char token);
 
 void delete_line(unsigned int line_number);
 void create_line(unsigned int line_number, char *s);
+void clear_jump_tables();
 
 void cmd_goto(char *args);
 void cmd_run(char *args);
@@ -65,9 +91,35 @@ void cmd_end(char *args);
 void cmd_edit(char *args);
 void cmd_rem(char *args);
 void cmd_write(char *args);
-
-// Basic command function type
-typedef void (* command_function) ();
+void cmd_memcpy(char *args);
+void cmd_memfill(char *args);
+void cmd_mem(char *args);
+void cmd_gosub(char *args);
+void cmd_return(char *args);
+void cmd_on(char *args);
+void cmd_profile(char *args);
+void cmd_compile(char *args);
+void cmd_poke(char *args);
+void cmd_peek(char *args);
+void cmd_sys(char *args);
+void cmd_bload(char *args);
+void cmd_overlay(char *args);
+void cmd_console(char *args);
+void cmd_fill(char *args);
+void cmd_copy(char *args);
+void cmd_scroll(char *args);
+void cmd_scr(char *args);
+void cmd_data(char *args);
+void cmd_read(char *args);
+void cmd_restore(char *args);
+void cmd_break(char *args);
+void cmd_step(char *args);
+void cmd_cont(char *args);
+void cmd_watch(char *args);
+void cmd_record(char *args);
+void cmd_replay(char *args);
+void cmd_task(char *args);
+void cmd_defchar(char *args);
 
 // Basic command function table
 const command_function command_functions[] = {
@@ -96,10 +148,41 @@ const command_function command_functions[] = {
   cmd_end,
   cmd_edit,
   cmd_rem,
-  cmd_write
+  cmd_write,
+  cmd_memcpy,
+  cmd_memfill,
+  cmd_mem,
+  cmd_gosub,
+  cmd_return,
+  cmd_on,
+  cmd_profile,
+  cmd_compile,
+  cmd_poke,
+  cmd_peek,
+  cmd_sys,
+  cmd_bload,
+  cmd_overlay,
+  cmd_console,
+  cmd_fill,
+  cmd_copy,
+  cmd_scroll,
+  cmd_scr,
+  cmd_data,
+  cmd_read,
+  cmd_restore,
+  cmd_break,
+  cmd_step,
+  cmd_cont,
+  cmd_watch,
+  cmd_record,
+  cmd_replay,
+  cmd_task,
+  cmd_defchar
 };
 
 // Basic command keyword table
+// Keywords are matched by prefix, so "memcpy" must come before "mem" and
+// "scroll" before "scr"
 const char *keywords[] = {
   "goto",
   "run",
@@ -127,11 +210,40 @@ const char *keywords[] = {
   "edit",
   "rem",
   "write",
+  "memcpy",
+  "memfill",
+  "mem",
+  "gosub",
+  "return",
+  "on",
+  "profile",
+  "compile",
+  "poke",
+  "peek",
+  "sys",
+  "bload",
+  "overlay",
+  "console",
+  "fill",
+  "copy",
+  "scroll",
+  "scr",
+  "data",
+  "read",
+  "restore",
+  "break",
+  "step",
+  "cont",
+  "watch",
+  "record",
+  "replay",
+  "task",
+  "defchar",
   0
 };
 
-// Return value of find_keyword() if the keyword wasn't found
-#define CMD_UNKNOWN 0xFF
+// Number of keywords (without the terminating 0)
+#define KEYWORD_COUNT (sizeof(keywords) / sizeof(keywords[0]) - 1)
 
 // Buffer used for priting messages to the LCD
 char print_buffer[41];
@@ -142,51 +254,117 @@ char parsebuf[256];
 // Temporary buffer
 char tmpbuf[256];
 
-// Data structure holding one line of BASIC code
-typedef struct _program_line {
-  unsigned int number;
-  unsigned char command;
-  char * args;
-  struct _program_line * next;
-} program_line;
-
 // Pointer to the first BASIC line
 program_line * program = NULL;
 
+// Pool holding the program line nodes
+pool line_pool = POOL_INITIALIZER(program_line);
+
 // Current line during program execution
 program_line * current_line;
 
+// Statement of the current line at which execute_line() resumes (set by RETURN)
+char * resume_statement;
+
+// Maximum nesting depth of GOSUB
+#define GOSUB_STACK_SIZE 16
+
+// Return address of a GOSUB
+typedef struct _return_address {
+  program_line * line;
+  char * statement;
+} return_address;
+
+// GOSUB return addresses of the main program and of the current task
+return_address main_gosub_stack[GOSUB_STACK_SIZE];
+return_address * gosub_stack = main_gosub_stack;
+unsigned char gosub_depth;
+
+// Maximum number of tasks including the main program (task 0), a power of 2
+#define MAX_TASKS 4
+
+// Number of lines a task executes before the next task runs
+#define TASK_SLICE_LINES 8
+
+// Execution state, private variables and LCD cursor position of a task while
+// another task runs
+typedef struct _task_context {
+  program_line * line;
+  char * statement;
+  return_address * gosub_stack;
+  variable * variables;
+  unsigned char gosub_depth;
+  unsigned char active;
+  unsigned char x;
+  unsigned char y;
+} task_context;
+
+task_context tasks[MAX_TASKS];
+unsigned char current_task;
+
+// Number of active tasks besides the main program
+unsigned char background_tasks;
+
+// Lines left until the next task switch
+unsigned char slice_lines;
+
+// True while a task runs because the current task waits for input
+unsigned char idle_task = 0;
+
+// Maximum number of targets of an ON ... GOTO/GOSUB statement
+#define MAX_JUMP_TARGETS 32
+
+// Maximum number of jump tables, further ON statements are resolved on every
+// execution
+#define MAX_JUMP_TABLES 64
+
+// Resolved targets of an ON ... GOTO/GOSUB statement. The table is created
+// when the statement is executed for the first time, its index is stored in
+// the jump table slot of the statement (see cmd_on()).
+typedef struct _jump_table {
+  char * targets_text;
+  unsigned char count;
+  program_line * targets[1];
+} jump_table;
+
+// Jump tables of the current program (cleared when the program is changed)
+jump_table * jump_tables[MAX_JUMP_TABLES];
+unsigned char jump_table_count = 0;
+
+// Targets of the last resolved jump table and their line numbers
+program_line * jump_targets[MAX_JUMP_TARGETS];
+unsigned int jump_target_numbers[MAX_JUMP_TARGETS];
+
+void format_line(char *buffer, program_line *line);
+void compress_line(char *buffer, program_line *line, unsigned int previous);
+char *expand_line(char *s, unsigned int *previous);
+
+// First byte of a compressed line and of the keyword tokens (see expand_line())
+#define TRANSFER_TOKEN 0x80
+
 // True if command has changed the current line
 unsigned char current_line_changed;
 
+// True if a command skips the remaining statements of the line (IF)
+unsigned char skip_statements;
+
 // True if a program is running
 unsigned char running = 0;
 
 // True if an error occourred
 unsigned char error = 0;
 
-// Language tokens
-#define TOKEN_INVALID       0
-#define TOKEN_END           1
-#define TOKEN_DIGITS        2
-#define TOKEN_STRING        3
-#define TOKEN_VAR_NUMBER    4
-#define TOKEN_VAR_STRING    5
-#define TOKEN_ASSIGN        6
-#define TOKEN_PLUS          7
-#define TOKEN_MINUS         8
-#define TOKEN_MUL           9
-#define TOKEN_DIV           10
-#define TOKEN_MOD           11
-#define TOKEN_COMMA         12
-#define TOKEN_EQUAL         13
-#define TOKEN_NOTEQUAL      14
-#define TOKEN_LESS          15
-#define TOKEN_LESSEQUAL     16
-#define TOKEN_GREATER       17
-#define TOKEN_GREATEREQUAL  18
-#define TOKEN_THEN          19
-#define TOKEN_ONERROR       20
+// Number of lines with a breakpoint (see cmd_break())
+unsigned char breakpoints = 0;
+
+// The debugger checks every line only if a breakpoint or a watch is set
+#define debugger_armed() (breakpoints || watches)
+
+// Line number and statement offset at which CONT and STEP continue a
+// stopped program (the offset is 0 at the start of the line)
+unsigned char stopped = 0;
+unsigned int stopped_number;
+unsigned int stopped_statement;
 
 // Descriptions of the tokens used in error messages
 const char *token_strings[] = {
@@ -200,6 +378,52 @@ const char *token_strings[] = {
  */
 void basic_init() {
   init_builtin_variables();
+  reset_tasks();
+}
+
+/**
+ * Install the program that was linked into the ROM (see bas2rom.rb) and run it
+ * if it was built with AUTORUN=1. The lines are already in the internal format,
+ * so they are linked into the program list without parsing.
+ * Return 1 if the program was run.
+ */
+unsigned char basic_autostart() {
+  const autostart_line *rom_line = autostart_program;
+  program_line *last_line = NULL;
+  unsigned int size;
+  program_line *new_line;
+
+  while (rom_line->args) {
+    new_line = pool_alloc(&line_pool);
+    if (! new_line) {
+      syntax_error_msg("Out of memory");
+      return 0;
+    }
+    new_line->number = rom_line->number;
+    new_line->command = rom_line->command;
+    new_line->flags = 0;
+    size = line_args_size((char *) rom_line->args);
+    if (! (new_line->args = malloc(size))) {
+      pool_free(&line_pool, new_line);
+      syntax_error_msg("Out of memory");
+      return 0;
+    }
+    memcpy(new_line->args, rom_line->args, size);
+    new_line->next = NULL;
+    if (last_line) {
+      last_line->next = new_line;
+    } else {
+      program = new_line;
+    }
+    last_line = new_line;
+    ++rom_line;
+  }
+
+  if (program && autostart_run) {
+    cmd_run(0);
+    return 1;
+  }
+  return 0;
 }
 
 /**
@@ -212,13 +436,18 @@ void interpret(char *s) {
 
   error = 0;
   current_line = 0;
+  current_line_changed = 0;
   running = 0;
 
   if (strlen(s) == 0) {
     return;
   }
 
+  PROFILE_ENTER(PROFILE_INTERPRET);
   if (isdigit(s[0])) {
+    // Editing the program ends overlay mode, the cached lines are kept
+    overlay_close();
+    stopped = 0;
     sscanf(s, "%u", &line_number);
     command = strchr(s, ' ');
     command = skip_whitespace(command);
@@ -228,17 +457,45 @@ void interpret(char *s) {
       delete_line(line_number);
     }
   } else {
-    execute((char *) command);
+    command = strdup(s);
+    execute(command);
+    free(command);
   }
+  PROFILE_EXIT(PROFILE_INTERPRET);
 }
 
 /**
- * Execute the BASIC command in 's'.
+ * Execute the BASIC statements in 's' (separated by ':').
+ * The separators in 's' are replaced by '\0'.
  */
 void execute(char *s) {
+  char *end;
+  char separator;
   unsigned char command;
-  char * args;
   reset_interrupted();
+  skip_statements = 0;
+  for (;;) {
+    end = find_statement_end(s);
+    separator = *end;
+    *end = '\0';
+    command = execute_statement(s);
+    if (command == CMD_UNKNOWN || command_functions[command] == cmd_rem) {
+      break;
+    }
+    if (! separator || error || skip_statements || current_line_changed) {
+      break;
+    }
+    s = end + 1;
+  }
+}
+
+/**
+ * Execute the single BASIC statement in 's'.
+ * Return the index of the command or CMD_UNKNOWN.
+ */
+unsigned char execute_statement(char *s) {
+  unsigned char command;
+  char * args;
   s = skip_whitespace(s);
   args = find_args(s);
   command = find_keyword(s);
@@ -247,6 +504,92 @@ void execute(char *s) {
   } else {
     lcd_puts("Unknown command!\n");
   }
+  return command;
+}
+
+/**
+ * Execute all statements of the current program line in one dispatch loop.
+ * The arguments of a program line are stored as
+ * <args> \0 { <command> <args> \0 } CMD_UNKNOWN
+ */
+void execute_line() {
+  char *args;
+  unsigned char command;
+  skip_statements = 0;
+  if (resume_statement) {
+    args = resume_statement;
+    resume_statement = NULL;
+    command = *args;
+    if (command == CMD_UNKNOWN) {
+      return;
+    }
+    ++args;
+  } else {
+    args = current_line->args;
+    command = current_line->command;
+  }
+  for (;;) {
+    command_functions[command](args);
+    if (error || skip_statements || current_line_changed) {
+      return;
+    }
+    args += strlen(args) + 1;
+    command = *args;
+    if (command == CMD_UNKNOWN) {
+      return;
+    }
+    ++args;
+  }
+}
+
+/**
+ * Return a pointer to the ':' that ends the statement in 's' or to the
+ * terminating '\0'. Colons in string constants are skipped.
+ */
+char *find_statement_end(char *s) {
+  unsigned char in_string = 0;
+  while (*s && (in_string || *s != ':')) {
+    if (*s == '"') {
+      in_string = ! in_string;
+    }
+    ++s;
+  }
+  return s;
+}
+
+/**
+ * Return the number of bytes of the encoded arguments 'args' of a program line.
+ */
+unsigned int line_args_size(char *args) {
+  char *p = args;
+  for (;;) {
+    p += strlen(p) + 1;
+    if (*((unsigned char *) p) == CMD_UNKNOWN) {
+      return p - args + 1;
+    }
+    ++p;
+  }
+}
+
+/**
+ * Write the text of the program line 'line' into 'buffer'.
+ */
+void format_line(char *buffer, program_line *line) {
+  char *args = line->args;
+  unsigned char command = line->command;
+  buffer += sprintf(buffer, "%u", line->number);
+  for (;;) {
+    buffer += sprintf(buffer, " %s %s", keywords[command],
+      command_functions[command] == cmd_on ? args + 1 : args);
+    args += strlen(args) + 1;
+    command = *args;
+    if (command == CMD_UNKNOWN) {
+      return;
+    }
+    ++args;
+    *buffer++ = ' ';
+    *buffer++ = ':';
+  }
 }
 
 /**
@@ -272,14 +615,14 @@ void print_interrupted() {
  * Return NULL if a syntax error occurred.
  */
 char *parse_number_expression(char *s, int *value) {
-  unsigned char token = next_token(s);
+  unsigned char token = lex(s);
 
   if (token == TOKEN_DIGITS || token == TOKEN_PLUS || token == TOKEN_MINUS ||
       token == TOKEN_VAR_NUMBER) {
     int operand;
     if (s = parse_number_term(s, value)) {
       for (;;) {
-        token = next_token(s);
+        token = lex(s);
         switch (token) {
           case TOKEN_PLUS:
           case TOKEN_MINUS:
@@ -287,12 +630,12 @@ char *parse_number_expression(char *s, int *value) {
           case TOKEN_DIV:
           case TOKEN_MOD:
           case TOKEN_EQUAL:
+          case TOKEN_NOTEQUAL:
           case TOKEN_LESS:
           case TOKEN_LESSEQUAL:
           case TOKEN_GREATER:
           case TOKEN_GREATEREQUAL:
-            s = consume_token(s, token);
-            if (s = parse_number_term(s, &operand)) {
+            if (s = parse_number_term(lex_ptr, &operand)) {
               switch (token) {
                 case TOKEN_PLUS:
                   *value += operand;
@@ -301,13 +644,19 @@ char *parse_number_expression(char *s, int *value) {
                   *value -= operand;
                   break;
                 case TOKEN_MUL:
-                  *value *= operand;
+                  *value = math_mul(*value, operand);
                   break;
                 case TOKEN_DIV:
-                  *value /= operand;
-                  break;
                 case TOKEN_MOD:
-                  *value %= operand;
+                  if (operand == 0) {
+                    syntax_error_msg("Division by zero");
+                    return NULL;
+                  }
+                  if (token == TOKEN_DIV) {
+                    *value = math_div(*value, operand);
+                  } else {
+                    *value = math_mod(*value, operand);
+                  }
                   break;
                 case TOKEN_EQUAL:
                   *value = *value == operand;
@@ -328,6 +677,8 @@ char *parse_number_expression(char *s, int *value) {
                   *value = *value >= operand;
                   break;
               }
+            } else {
+              return NULL;
             }
             break;
           default:
@@ -339,11 +690,11 @@ char *parse_number_expression(char *s, int *value) {
   } else if (token == TOKEN_STRING || token == TOKEN_VAR_STRING) {
     char *string;
     if (s = parse_string_expression(s, &string)) {
-      token = next_token(s);
+      token = lex(s);
       if (token == TOKEN_EQUAL || token == TOKEN_NOTEQUAL ||
           token == TOKEN_LESS || token == TOKEN_LESSEQUAL ||
           token == TOKEN_GREATER || token == TOKEN_GREATEREQUAL) {
-        s = consume_token(s, token);
+        s = lex_ptr;
         strcpy(tmpbuf, string);
         if (s = parse_string_expression(s, &string)) {
           switch (token) {
@@ -382,21 +733,20 @@ char *parse_number_expression(char *s, int *value) {
  * Return NULL if a syntax error occurred.
  */
 char *parse_number_term(char *s, int *value) {
-  unsigned char token;
-  s = skip_whitespace(s);
-  token = next_token(s);
-  if (token == TOKEN_DIGITS || token == TOKEN_PLUS || token == TOKEN_MINUS) {
+  unsigned char token = lex(s);
+  if (token == TOKEN_DIGITS) {
+    *value = lex_value;
+    return lex_ptr;
+  } else if (token == TOKEN_PLUS || token == TOKEN_MINUS) {
     if (s = parse_integer(s, value)) {
       return s;
     } else {
       syntax_error_invalid_number();
     }
   } else if (token == TOKEN_VAR_NUMBER) {
-    unsigned int var_name;
-    unsigned char var_type;
     variable *var;
-    s = parse_variable(s, &var_name, &var_type);
-    var = find_variable(var_name, VAR_TYPE_INTEGER, NULL);
+    s = lex_ptr;
+    var = find_variable(lex_value, VAR_TYPE_INTEGER, NULL);
     if (var) {
       *value = get_integer_variable_value(var);
       return s;
@@ -417,24 +767,19 @@ char *parse_number_term(char *s, int *value) {
  * Return NULL if a syntax error occurred.
  */
 char *parse_string_expression(char *s, char **value) {
-  unsigned int var_name;
   variable *var;
-  unsigned char var_type;
-  unsigned char token;
-
-  s = skip_whitespace(s);
-  token = next_token(s);
+  unsigned char token = lex(s);
 
   if (token == TOKEN_STRING) {
-    if (s = parse_string(s, parsebuf)) {
+    if (s = copy_string_token(parsebuf)) {
       *value = parsebuf;
       return s;
     } else {
       syntax_error_invalid_string();
     }
   } else if (token == TOKEN_VAR_STRING) {
-    s = parse_variable(s, &var_name, &var_type);
-    var = find_variable(var_name, VAR_TYPE_STRING, NULL);
+    s = lex_ptr;
+    var = find_variable(lex_value, VAR_TYPE_STRING, NULL);
     if (var) {
       *value = get_string_variable_value(var);
       return s;
@@ -455,21 +800,25 @@ char *parse_string_expression(char *s, char **value) {
  * If no string argument is found, NULL is returned and 'value' is not modified.
  */
 char *parse_string(char *s, char *value) {
-  char *right_mark;
-  s = skip_whitespace(s);
-  if (*s == '"') {
-    ++s;
-    right_mark = strchr(s, '"');
-    if (right_mark) {
-      int len = right_mark - s;
-      strncpy(value, s, len);
-      *(value + len) = '\0';
-      return right_mark + 1;
-    }
+  if (lex(s) == TOKEN_STRING) {
+    return copy_string_token(value);
   }
   return NULL;
 }
 
+/**
+ * Copy the text of the string token that was just lexed to the buffer 'value'.
+ * Return a pointer behind the string token or NULL if the string isn't terminated.
+ */
+char *copy_string_token(char *value) {
+  if (lex_ptr) {
+    int len = lex_ptr - 1 - (char *) lex_value;
+    strncpy(value, (char *) lex_value, len);
+    *(value + len) = '\0';
+  }
+  return lex_ptr;
+}
+
 /**
  * Parse an integer argument(+-0..9+) in the string pointed to by 's'.
  * If an integer argument is found, its value is returned in 'value' and a pointer
@@ -477,14 +826,15 @@ char *parse_string(char *s, char *value) {
  * If no integer argument is found, NULL is returned.
  */
 char *parse_integer(char *s, int *value) {
-  s = skip_whitespace(s);
-  if(*s == '+' || *s == '-' || isdigit(*s)) {
-    sscanf(s, "%d", value);
-    ++s;
-    while (isdigit(*s)) {
-      ++s;
-    }
-    return s;
+  unsigned char token = lex(s);
+  unsigned char negative = 0;
+  if (token == TOKEN_PLUS || token == TOKEN_MINUS) {
+    negative = token == TOKEN_MINUS;
+    token = lex(lex_ptr);
+  }
+  if (token == TOKEN_DIGITS) {
+    *value = negative ? -lex_value : lex_value;
+    return lex_ptr;
   }
   return NULL;
 }
@@ -495,22 +845,11 @@ char *parse_integer(char *s, int *value) {
  * If no variable is found, NULL is returned;
  */
 char *parse_variable(char *s, unsigned int *name, unsigned char *type) {
-  s = skip_whitespace(s);
-  if (isalpha(*s)) {
-    *name = *s;
-    ++s;
-    if (isalnum(*s)) {
-      *name <<= 8;
-      *name |= *s;
-    }
-    while (isalnum(*s)) { ++s; }
-    if (*s == '$') {
-      ++s;
-      *type = VAR_TYPE_STRING;
-    } else {
-      *type = VAR_TYPE_INTEGER;
-    }
-    return s;
+  unsigned char token = lex(s);
+  if (token == TOKEN_VAR_NUMBER || token == TOKEN_VAR_STRING) {
+    *name = lex_value;
+    *type = token == TOKEN_VAR_STRING ? VAR_TYPE_STRING : VAR_TYPE_INTEGER;
+    return lex_ptr;
   }
   return NULL;
 }
@@ -519,93 +858,30 @@ char *parse_variable(char *s, unsigned int *name, unsigned char *type) {
  * Consume the token 'token' in the string 's'.
  * Return a pointer behind the token.
  * If the token wasn't found, return NULL with a syntax error.
- * Currently only implemented for operator tokens.
  */
 char *consume_token(char *s, unsigned char token) {
-  s = skip_whitespace(s);
-  if ((token == TOKEN_ASSIGN && *s == '=') ||
-      (token == TOKEN_PLUS && *s == '+') ||
-      (token == TOKEN_MINUS && *s == '-') ||
-      (token == TOKEN_MUL && *s == '*') ||
-      (token == TOKEN_DIV && *s == '/') ||
-      (token == TOKEN_MOD && *s == '%') ||
-      (token == TOKEN_COMMA && *s == ',')) {
-    return s + 1;
-  } else if (token == TOKEN_ASSIGN && *s == '=' && *(s + 1) != '=') {
-    return s + 1;
-  } else if (token == TOKEN_EQUAL && *s == '=' && *(s + 1) == '=') {
-    return s + 2;
-  } else if (token == TOKEN_LESS && *s == '<' && *(s + 1) != '=') {
-    return s + 1;
-  } else if (token == TOKEN_LESSEQUAL && *s == '<' && *(s + 1) == '=') {
-    return s + 2;
-  } else if (token == TOKEN_GREATER && *s == '>' && *(s + 1) != '=') {
-    return s + 1;
-  } else if (token == TOKEN_GREATEREQUAL && *s == '>' && *(s + 1) == '=') {
-    return s + 2;
-  } else if (token == TOKEN_THEN && strncmp(s, "then", 4) == 0) {
-    return s + 4;
-  } else if (token == TOKEN_ONERROR && strncmp(s, "onerror", 7) == 0) {
-    return s + 7;
-  }
-  syntax_error_invalid_token(next_token(s));
+  if (lex(s) == token) {
+    return lex_ptr;
+  }
+  syntax_error_invalid_token(lex_token);
   return NULL;
 }
 
 /**
- * Get the token id of the first token in 's'.
+ * Parse 'count' comma separated number expressions into 'values'.
+ * Return a pointer behind the last expression or NULL if a syntax error occurred.
  */
-unsigned char next_token(char *s) {
-  s = skip_whitespace(s);
-  if(isdigit(*s)){
-    return TOKEN_DIGITS;
-  } else if (strncasecmp(s, "then", 4) == 0) {
-    return TOKEN_THEN;
-  } else if (strncasecmp(s, "onerror", 7) == 0) {
-    return TOKEN_ONERROR;
-  } else if (isalpha(*s)) {
-    while (isalnum(*s)) { ++s; }
-    if (*s == '$') {
-      return TOKEN_VAR_STRING;
-    } else {
-      return TOKEN_VAR_NUMBER;
-    }
-  } else if (*s == '"') {
-    return TOKEN_STRING;
-  } else if (*s == '=') {
-    ++s;
-    if (*s == '=') {
-      return TOKEN_EQUAL;
-    }
-    return TOKEN_ASSIGN;
-  } else if (*s == '<') {
-    ++s;
-    if (*s == '=') {
-      return TOKEN_LESSEQUAL;
+char *parse_number_list(char *s, int *values, unsigned char count) {
+  while (s = parse_number_expression(s, values++)) {
+    if (--count == 0) {
+      break;
     }
-    return TOKEN_LESS;
-  } else if (*s == '>') {
-    ++s;
-    if (*s == '=') {
-      return TOKEN_GREATEREQUAL;
+    s = consume_token(s, TOKEN_COMMA);
+    if (! s) {
+      break;
     }
-    return TOKEN_GREATER;
-  } else if (*s == '+') {
-    return TOKEN_PLUS;
-  } else if (*s == '-') {
-    return TOKEN_MINUS;
-  } else if (*s == '*') {
-    return TOKEN_MUL;
-  } else if (*s == '/') {
-    return TOKEN_DIV;
-  } else if (*s == '%') {
-    return TOKEN_MOD;
-  } else if (*s == ',') {
-    return TOKEN_COMMA;
-  } else if (*s == '\0' || *s == ';') {
-    return TOKEN_END;
   }
-  return TOKEN_INVALID;
+  return s;
 }
 
 /**
@@ -681,6 +957,9 @@ void syntax_error_invalid_token(unsigned char token) {
 void delete_line(unsigned int number) {
   program_line *prev_line = 0;
   program_line *line = program;
+  clear_jump_tables();
+  compiler_free();
+  data_free();
   while (line) {
     if (line->number == number) {
       if (prev_line) {
@@ -688,8 +967,11 @@ void delete_line(unsigned int number) {
       } else {
         program = line->next;
       }
+      if (line->flags & LINE_FLAG_BREAK) {
+        --breakpoints;
+      }
       free(line->args);
-      free(line);
+      pool_free(&line_pool, line);
       break;
     }
     prev_line = line;
@@ -698,34 +980,236 @@ void delete_line(unsigned int number) {
 }
 
 /**
- * Create a new program line with number 'number' and the command in 's'.
+ * Create a new program line with number 'number' and the statements in 's'.
+ * The statements are encoded into tmpbuf first (see execute_line()).
  */
 void create_line(unsigned int number, char *s) {
   unsigned char command;
+  unsigned char first_command;
   char * args;
+  char * end;
+  char * out = tmpbuf;
+  char separator;
+  unsigned int size;
   program_line * new_line;
-  args = find_args(s);
-  command = find_keyword(s);
-  if (command != CMD_UNKNOWN) {
-    delete_line(number);
-    new_line = malloc(sizeof(program_line));
-    new_line->number = number;
-    new_line->command = command;
-    new_line->args = malloc(strlen(args) + 1);
-    strcpy(new_line->args, args);
-    if (program && number > program->number) {
-      program_line *line = program;
-      while (line->next && number > line->next->number) {
-        line = line->next;
-      }
-      new_line->next = line->next;
-      line->next = new_line;
+
+  for (;;) {
+    end = find_statement_end(s);
+    separator = *end;
+    *end = '\0';
+    s = skip_whitespace(s);
+    command = find_keyword(s);
+    if (command == CMD_UNKNOWN) {
+      lcd_puts("Unknown command!\n");
+      return;
+    }
+    if (command_functions[command] == cmd_rem) {
+      *end = separator;
+      separator = '\0';
+    }
+    if (out == tmpbuf) {
+      first_command = command;
     } else {
-      new_line->next = program;
-      program = new_line;
+      *out++ = command;
+    }
+    if (command_functions[command] == cmd_on) {
+      *out++ = JUMP_SLOT;
+    }
+    args = find_args(s);
+    strcpy(out, args);
+    args = out;
+    out += strlen(out);
+    while (separator && out > args && *(out - 1) == ' ') {
+      --out;
     }
+    *out++ = '\0';
+    if (! separator) {
+      break;
+    }
+    s = end + 1;
+  }
+  *out++ = CMD_UNKNOWN;
+  size = out - tmpbuf;
+
+  delete_line(number);
+  new_line = pool_alloc(&line_pool);
+  if (! new_line) {
+    syntax_error_msg("Out of memory");
+    return;
+  }
+  new_line->number = number;
+  new_line->command = first_command;
+  new_line->flags = 0;
+  new_line->args = malloc(size);
+  memcpy(new_line->args, tmpbuf, size);
+  if (program && number > program->number) {
+    program_line *line = program;
+    while (line->next && number > line->next->number) {
+      line = line->next;
+    }
+    new_line->next = line->next;
+    line->next = new_line;
   } else {
-    lcd_puts("Unknown command!\n");
+    new_line->next = program;
+    program = new_line;
+  }
+}
+
+/**
+ * Return the program line with number 'number' or NULL if there is no such line.
+ */
+program_line *find_line(unsigned int number) {
+  program_line *line;
+  if (overlay_blocks && ! overlay_load(number)) {
+    return NULL;
+  }
+  line = program;
+  while (line && line->number != number) {
+    line = line->next;
+  }
+  return line;
+}
+
+/**
+ * Parse the line number in 's' and return the program line with this number.
+ * Return NULL with an error if there is no line number or no such line.
+ */
+program_line *parse_line_number(char *s) {
+  unsigned int line_number;
+  program_line *line;
+  if (isdigit(s[0])) {
+    sscanf(s, "%u", &line_number);
+    if (line = find_line(line_number)) {
+      return line;
+    }
+    if (! error) {
+      syntax_error_msg("Line not found");
+    }
+  } else {
+    syntax_error();
+  }
+  return NULL;
+}
+
+/**
+ * Return 1 if the running program still needs a line in the range
+ * 'first'..'last', i.e. the current line or a GOSUB return address.
+ */
+unsigned char line_in_use(unsigned int first, unsigned int last) {
+  unsigned char i;
+  if (current_line && current_line->number >= first && current_line->number <= last) {
+    return 1;
+  }
+  for (i = 0; i < gosub_depth; ++i) {
+    if (gosub_stack[i].line->number >= first && gosub_stack[i].line->number <= last) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * Continue the program execution with the program line 'line'.
+ */
+void jump_to(program_line *line) {
+  current_line = line;
+  current_line_changed = 1;
+}
+
+/**
+ * Push the return address of a GOSUB statement with the arguments 'args'.
+ * The program continues with the statement behind it on RETURN.
+ * Return 0 with an error if the GOSUB stack is full or in direct mode, where
+ * there is no line to return to.
+ */
+unsigned char push_return_address(char *args) {
+  if (! current_line) {
+    syntax_error_msg("Not in direct mode");
+    return 0;
+  }
+  if (gosub_depth == GOSUB_STACK_SIZE) {
+    syntax_error_msg("Stack overflow");
+    return 0;
+  }
+  gosub_stack[gosub_depth].line = current_line;
+  gosub_stack[gosub_depth].statement = args + strlen(args) + 1;
+  ++gosub_depth;
+  return 1;
+}
+
+/**
+ * Resolve the comma separated line numbers in 's' into jump_targets.
+ * Targets that don't exist are stored as NULL.
+ * Return the number of targets or 0 if a syntax error occurred.
+ */
+unsigned char resolve_jump_targets(char *s) {
+  unsigned char count = 0;
+  for (;;) {
+    if (lex(s) != TOKEN_DIGITS) {
+      syntax_error_invalid_token(lex_token);
+      return 0;
+    }
+    if (count == MAX_JUMP_TARGETS) {
+      syntax_error_msg("Too many targets");
+      return 0;
+    }
+    // In overlay mode every lookup may evict lines, so only the selected
+    // target is looked up (see cmd_on())
+    jump_target_numbers[count] = lex_value;
+    jump_targets[count++] = overlay_blocks ? NULL : find_line(lex_value);
+    s = lex_ptr;
+    if (lex(s) == TOKEN_END) {
+      return count;
+    }
+    if (! (s = consume_token(s, TOKEN_COMMA))) {
+      return 0;
+    }
+  }
+}
+
+/**
+ * Return the jump table of the target list 's' of an ON statement. 'slot'
+ * points to the jump table slot of the statement or is NULL if it has none.
+ * The table of a statement with a slot is resolved only once and then taken
+ * from jump_tables, the slot of a cleared table is stale and fails the check
+ * of the target list. Other target lists are resolved into a temporary table.
+ * Return NULL if an error occurred.
+ */
+program_line **find_jump_targets(char *slot, char *s, unsigned char *count) {
+  jump_table *table;
+  unsigned char index;
+  if (slot) {
+    index = (unsigned char) *slot - JUMP_SLOT;
+    if (index < jump_table_count && (table = jump_tables[index])->targets_text == s) {
+      *count = table->count;
+      return table->targets;
+    }
+  }
+  if (! (*count = resolve_jump_targets(s))) {
+    return NULL;
+  }
+  if (! slot || overlay_blocks || jump_table_count == MAX_JUMP_TABLES) {
+    return jump_targets;
+  }
+  table = malloc(sizeof(jump_table) + (*count - 1) * sizeof(program_line *));
+  if (! table) {
+    syntax_error_msg("Out of memory");
+    return NULL;
+  }
+  table->targets_text = s;
+  table->count = *count;
+  memcpy(table->targets, jump_targets, *count * sizeof(program_line *));
+  *slot = JUMP_SLOT + jump_table_count;
+  jump_tables[jump_table_count++] = table;
+  return table->targets;
+}
+
+/**
+ * Free the jump tables. This must be done whenever a program line changes.
+ */
+void clear_jump_tables() {
+  while (jump_table_count) {
+    free(jump_tables[--jump_table_count]);
   }
 }
 
@@ -752,7 +1236,7 @@ void cmd_put(char *args) {
   char *string_value;
   unsigned char token;
   while (! error) {
-    token = next_token(args);
+    token = lex(args);
     if (token == TOKEN_STRING || token == TOKEN_VAR_STRING) {
       if (args = parse_string_expression(args, &string_value)) {
         lcd_puts(string_value);
@@ -764,7 +1248,7 @@ void cmd_put(char *args) {
         lcd_puts(print_buffer);
       }
     } else if (token == TOKEN_COMMA) {
-      args = consume_token(args, token);
+      args = lex_ptr;
     } else if (token == TOKEN_END) {
       return;
     } else {
@@ -815,8 +1299,9 @@ void cmd_list(char *args) {
           keys_update();
         } while (keys_get_code() == KEY_NONE);
       }
-      sprintf(print_buffer, "%u %s %s\n", line->number, keywords[line->command], line->args);
-      lcd_puts(print_buffer);
+      format_line(tmpbuf, line);
+      lcd_puts(tmpbuf);
+      lcd_put_newline();
     }
     line = line->next;
   }
@@ -825,75 +1310,411 @@ void cmd_list(char *args) {
 }
 
 /**
- * Run the program.
+ * Run the program and print "Ready." at its end, unless RUN was executed by
+ * a running program.
  * RUN
  */
 void cmd_run(char *) {
-  unsigned char command;
+  unsigned char nested = running;
+  start_program();
+  if (debugger_armed()) {
+    debug_lines(0, 0);
+  } else {
+    if (compiled_code) {
+      compiled_run();
+      current_line = NULL;
+    }
+    run_lines();
+  }
+  running = nested;
+  print_ready();
+}
+
+/**
+ * Reset the program state and set current_line to the first line.
+ */
+void start_program() {
   error = 0;
   running = 1;
-  current_line = program;
+  stopped = 0;
   current_line_changed = 0;
+  resume_statement = NULL;
+  gosub_depth = 0;
+  reset_tasks();
+  data_rewind();
+  current_line = NULL;  // No line is in use while the first one is fetched
+  current_line = overlay_blocks ? overlay_first_line() : program;
+}
+
+/**
+ * Remember the position of the program, CONT and STEP continue there.
+ */
+void stop_program() {
+  stopped = 1;
+  stopped_number = current_line->number;
+  stopped_statement = resume_statement ? resume_statement - current_line->args : 0;
+}
+
+/**
+ * Execute the program from current_line until its end, an error or an
+ * interruption.
+ */
+void run_lines() {
   while (current_line) {
     if (is_interrupted()) {
       print_interrupted();
       lcd_cursor_blink();
+      stop_program();
       break;
     }
-    command = current_line->command;
-    command_functions[command](current_line->args);
+    execute_line();
     if (error) {
       break;
     }
+    if (console_active()) {
+      console_update();
+    }
     if (current_line_changed) {
       current_line_changed = 0;
-      if (! current_line) {
-        break;
-      }
+    } else if (overlay_blocks) {
+      current_line = overlay_next_line(current_line);
     } else {
       current_line = current_line->next;
     }
-  }
-  print_ready();
-}
-
-/**
- * Jump to another program line.
- * GOTO <line>
- */
-void cmd_goto(char *args) {
-  unsigned int line_number;
-  program_line *line;
-  if (isdigit(args[0])) {
-    sscanf(args, "%u", &line_number);
-    line = program;
-    while (line) {
-      if (line->number == line_number) {
-        current_line = line;
-        current_line_changed = 1;
-        return;
-      }
-      line = line->next;
+    if (background_tasks) {
+      schedule_tasks();
     }
-    syntax_error_msg("Line not found");
-  } else {
-    syntax_error();
   }
-}
-
-/**
- * Clear the program and the variables.
- */
-void cmd_new(char *args) {
-  program_line * line = program;
-  while (line) {
-    program_line * next = line->next;
-    free(line->args);
-    free(line);
-    line = next;
+  if (! stopped) {
+    reset_tasks();
   }
-  program = 0;
-  cmd_clear(args);
+}
+
+/**
+ * Execute the program like run_lines(), but stop before a line with a
+ * breakpoint, behind a line that changed a watched variable and, if 'step' is
+ * true, behind the first line. If 'resume' is true, the first line is executed
+ * even if it has a breakpoint (CONT after a break).
+ */
+void debug_lines(unsigned char step, unsigned char resume) {
+  unsigned char first = resume;
+  watch_hit = NULL;
+  while (current_line) {
+    if (is_interrupted()) {
+      print_interrupted();
+      lcd_cursor_blink();
+      stop_program();
+      return;
+    }
+    if (! first && (step || (current_line->flags & LINE_FLAG_BREAK && ! resume_statement))) {
+      format_line(tmpbuf, current_line);
+      lcd_puts("Break ");
+      lcd_puts(tmpbuf);
+      lcd_put_newline();
+      stop_program();
+      return;
+    }
+    first = 0;
+    execute_line();
+    if (error) {
+      break;
+    }
+    if (console_active()) {
+      console_update();
+    }
+    if (watch_hit) {
+      print_variable_assignment(watch_hit);
+      watch_hit = NULL;
+      step = 1;
+    }
+    if (current_line_changed) {
+      current_line_changed = 0;
+    } else if (overlay_blocks) {
+      current_line = overlay_next_line(current_line);
+    } else {
+      current_line = current_line->next;
+    }
+    if (background_tasks) {
+      schedule_tasks();
+    }
+  }
+  reset_tasks();
+}
+
+/**
+ * Continue the stopped program, with 'step' true for one line only.
+ */
+void continue_program(unsigned char step) {
+  if (! stopped) {
+    syntax_error_msg("Cannot continue");
+    return;
+  }
+  stopped = 0;
+  error = 0;
+  running = 1;
+  current_line_changed = 0;
+  if (! (current_line = find_line(stopped_number))) {
+    if (! error) {
+      syntax_error_msg("Line not found");
+    }
+    return;
+  }
+  resume_statement = stopped_statement ? current_line->args + stopped_statement : NULL;
+  if (step || debugger_armed()) {
+    debug_lines(step, 1);
+  } else {
+    run_lines();
+  }
+  print_ready();
+}
+
+/**
+ * Stop all tasks, the main program becomes the current task.
+ */
+void reset_tasks() {
+  unsigned char n;
+  for (n = 1; n < MAX_TASKS; ++n) {
+    if (tasks[n].active) {
+      tasks[n].active = 0;
+      free(tasks[n].gosub_stack);
+      free_variables(&tasks[n].variables);
+    }
+  }
+  background_tasks = 0;
+  current_task = 0;
+  tasks[0].active = 1;
+  tasks[0].gosub_stack = main_gosub_stack;
+  gosub_stack = main_gosub_stack;
+  scope = &variables;
+  slice_lines = TASK_SLICE_LINES;
+}
+
+/**
+ * Save the state of the current task (at the start of a line).
+ */
+void save_task() {
+  task_context *task = &tasks[current_task];
+  task->line = current_line;
+  task->statement = resume_statement;
+  task->gosub_depth = gosub_depth;
+  task->x = lcd_get_x();
+  task->y = lcd_get_y();
+}
+
+/**
+ * Make task 'n' the current task.
+ */
+void load_task(unsigned char n) {
+  task_context *task = &tasks[n];
+  current_task = n;
+  current_line = task->line;
+  resume_statement = task->statement;
+  gosub_stack = task->gosub_stack;
+  gosub_depth = task->gosub_depth;
+  scope = n ? &task->variables : &variables;
+  slice_lines = TASK_SLICE_LINES;
+  lcd_goto(task->x, task->y);
+}
+
+/**
+ * Remove the background task 'n'.
+ */
+void end_task(unsigned char n) {
+  tasks[n].active = 0;
+  free(tasks[n].gosub_stack);
+  free_variables(&tasks[n].variables);
+  --background_tasks;
+}
+
+/**
+ * Called behind every line while background tasks are active: end the current
+ * task at its end or switch to the next task when its time slice is used up.
+ * The program ends with the end of the main program.
+ */
+void schedule_tasks() {
+  unsigned char n = current_task;
+  if (current_line) {
+    if (--slice_lines) {
+      return;
+    }
+    save_task();
+  } else if (n) {
+    end_task(n);
+  } else {
+    return;
+  }
+  do {
+    n = (n + 1) & (MAX_TASKS - 1);
+  } while (! tasks[n].active);
+  load_task(n);
+}
+
+/**
+ * Run a time slice of the next task while the current task waits for input in
+ * readline(), the main program too if a background task waits. The waiting
+ * task is restored afterwards. An error ends the input like an interruption.
+ * If the main program ends here, the program ends at the next task switch.
+ */
+void run_idle_task() {
+  unsigned char waiting = current_task;
+  unsigned char changed = current_line_changed;
+  unsigned char skip = skip_statements;
+  unsigned char n = waiting;
+  unsigned char i;
+
+  if (idle_task) {
+    return;
+  }
+  for (i = MAX_TASKS - 1; i; --i) {
+    n = (n + 1) & (MAX_TASKS - 1);
+    if (tasks[n].active && (n || tasks[0].line)) {
+      break;
+    }
+  }
+  if (! i) {
+    return;
+  }
+
+  idle_task = 1;
+  save_task();
+  load_task(n);
+  current_line_changed = 0;
+  do {
+    execute_line();
+    if (error) {
+      interrupted = 1;
+      break;
+    }
+    if (current_line_changed) {
+      current_line_changed = 0;
+    } else {
+      current_line = current_line->next;
+    }
+    if (! current_line) {
+      if (n) {
+        end_task(n);
+      }
+      break;
+    }
+  } while (--slice_lines);
+  if (tasks[n].active) {
+    save_task();
+  }
+  load_task(waiting);
+  current_line_changed = changed;
+  skip_statements = skip;
+  idle_task = 0;
+}
+
+/**
+ * Jump to another program line.
+ * GOTO <line>
+ */
+void cmd_goto(char *args) {
+  program_line *line;
+  if (line = parse_line_number(args)) {
+    jump_to(line);
+  }
+}
+
+/**
+ * Call a subroutine.
+ * GOSUB <line>
+ */
+void cmd_gosub(char *args) {
+  program_line *line;
+  if ((line = parse_line_number(args)) && push_return_address(args)) {
+    jump_to(line);
+  }
+}
+
+/**
+ * Return from a subroutine to the statement behind the last GOSUB.
+ * RETURN
+ */
+void cmd_return(char *) {
+  if (gosub_depth == 0) {
+    syntax_error_msg("Return without gosub");
+    return;
+  }
+  --gosub_depth;
+  jump_to(gosub_stack[gosub_depth].line);
+  resume_statement = gosub_stack[gosub_depth].statement;
+}
+
+/**
+ * Jump to (or call) the line at position <index> (1..n) in the target list.
+ * If <index> is out of range, the program continues with the next statement.
+ * In a program line the arguments start with the jump table slot (see
+ * create_line()), behind THEN and in direct mode they have none.
+ * ON <index> GOTO|GOSUB <line> [, <line> ...]
+ */
+void cmd_on(char *args) {
+  int index;
+  unsigned char gosub;
+  unsigned char count;
+  char *s;
+  char *slot = NULL;
+  program_line **targets;
+  program_line *line;
+
+  if ((unsigned char) *args >= JUMP_SLOT) {
+    slot = args;
+  }
+  if (! (s = parse_number_expression(skip_jump_slot(args), &index))) {
+    return;
+  }
+  s = skip_whitespace(s);
+  if (strncasecmp(s, "gosub", 5) == 0) {
+    gosub = 1;
+    s += 5;
+  } else if (strncasecmp(s, "goto", 4) == 0) {
+    gosub = 0;
+    s += 4;
+  } else {
+    syntax_error();
+    return;
+  }
+  if (! (targets = find_jump_targets(slot, s, &count))) {
+    return;
+  }
+  if (index < 1 || index > count) {
+    return;
+  }
+  line = targets[index - 1];
+  if (overlay_blocks) {
+    line = find_line(jump_target_numbers[index - 1]);
+  }
+  if (! line) {
+    if (! error) {
+      syntax_error_msg("Line not found");
+    }
+    return;
+  }
+  if (! gosub || push_return_address(args)) {
+    jump_to(line);
+  }
+}
+
+/**
+ * Clear the program and the variables.
+ */
+void cmd_new(char *args) {
+  program_line * line = program;
+  while (line) {
+    free(line->args);
+    line = line->next;
+  }
+  program = 0;
+  breakpoints = 0;
+  stopped = 0;
+  reset_tasks();
+  overlay_close();
+  clear_jump_tables();
+  compiler_free();
+  data_free();
+  pool_free_all(&line_pool);
+  cmd_clear(args);
 }
 
 /**
@@ -903,25 +1724,121 @@ void cmd_new(char *args) {
 void cmd_free(char *) {
   sprintf(print_buffer, "%u bytes free.\n", _heapmemavail());
   lcd_puts(print_buffer);
+  sprintf(print_buffer, "Pools: vars %u/%u, lines %u/%u\n",
+    variable_pool.used, variable_pool.capacity, line_pool.used, line_pool.capacity);
+  lcd_puts(print_buffer);
+}
+
+/**
+ * Return the number of bytes used by the program lines.
+ */
+unsigned int program_size() {
+  unsigned int size = 0;
+  program_line *line = program;
+  while (line) {
+    size += sizeof(program_line) + line_args_size(line->args);
+    line = line->next;
+  }
+  return size;
+}
+
+/**
+ * Return the memory statistic 'n' (see cmd_mem()).
+ */
+unsigned int mem_value(unsigned char n) {
+  unsigned int strings_size;
+  switch (n) {
+    case 0:
+      return mem_heap_free();
+    case 1:
+      return mem_heap_largest_block();
+    case 2:
+      return mem_heap_fragments();
+    case 3:
+      return program_size();
+    case 4:
+      return variables_size(&strings_size);
+    case 5:
+      variables_size(&strings_size);
+      return strings_size;
+    case 6:
+      return mem_c_stack_used();
+    case 7:
+      return mem_cpu_stack_used();
+    case 8:
+      return overlay_hits;
+    default:
+      return overlay_misses;
+  }
+}
+
+/**
+ * Print the heap, program and stack memory usage or read one value into an
+ * integer variable: 0 free heap bytes, 1 largest free block, 2 heap fragments,
+ * 3 program bytes, 4 variable bytes, 5 string bytes, 6 C stack and 7 CPU stack
+ * high-water mark, 8 overlay block hits, 9 overlay block misses.
+ * MEM [<n>, <variable>]
+ */
+void cmd_mem(char *args) {
+  int n;
+  int value;
+  unsigned int var_name;
+  unsigned char var_type;
+  unsigned int strings_size;
+  unsigned int vars_size;
+
+  if (*args) {
+    if (! (args = parse_number_expression(args, &n))) {
+      return;
+    }
+    if (! (args = consume_token(args, TOKEN_COMMA))) {
+      return;
+    }
+    if (n >= 0 && n <= 9 && parse_variable(args, &var_name, &var_type) && var_type == VAR_TYPE_INTEGER) {
+      value = mem_value(n);
+      create_variable(var_name, var_type, &value);
+    } else {
+      syntax_error_invalid_argument();
+    }
+    return;
+  }
+  vars_size = variables_size(&strings_size);
+  sprintf(print_buffer, "Heap %u free, %u max, %u frag\n",
+    mem_heap_free(), mem_heap_largest_block(), mem_heap_fragments());
+  lcd_puts(print_buffer);
+  sprintf(print_buffer, "Prog %u, vars %u, strings %u\n",
+    program_size(), vars_size, strings_size);
+  lcd_puts(print_buffer);
+  sprintf(print_buffer, "Stack C %u/%u, CPU %u/256\n",
+    mem_c_stack_used(), mem_c_stack_size(), mem_cpu_stack_used());
+  lcd_puts(print_buffer);
+  print_ready();
 }
 
 /**
  * Save a program by sending it to the terminal program over the serial line.
+ * The lines are sent compressed (see expand_line()).
  * SAVE "<filename>"
  */
 void cmd_save(char *args) {
   char *filename;
   if (parse_string_expression(args, &filename)) {
     program_line *line = program;
+    unsigned int previous = 0;
     lcd_puts("Saving...");
     acia_puts("*SAVE \"");
     acia_puts(filename);
-    acia_puts("\"\n");
+    acia_puts("\" Z\n");
     while (line) {
-      sprintf(print_buffer, "%u %s %s\n", line->number, keywords[line->command], line->args);
-      acia_puts(print_buffer);
+      compress_line(tmpbuf, line, previous);
+      previous = line->number;
+      acia_puts(tmpbuf);
+      acia_put_newline();
       line = line->next;
-      lcd_putc('.');
+      // In console mode the dot would be sent in front of the next line
+      if (! console_active()) {
+        lcd_putc('.');
+      }
     }
     acia_puts("*EOF\n");
     lcd_put_newline();
@@ -933,28 +1850,37 @@ void cmd_save(char *args) {
 
 /**
  * Load a program by reading it from the terminal program over the serial line.
+ * The terminal program may send the lines compressed (see expand_line()).
  * LOAD "<filename>"
  */
 void cmd_load(char *args) {
   char *filename;
+  char *s;
+  unsigned int previous = 0;
   if (parse_string_expression(args, &filename)) {
     cmd_new(0);
     lcd_puts("Loading...");
     acia_puts("*LOAD \"");
     acia_puts(filename);
-    acia_puts("\"\n");
+    acia_puts("\" Z\n");
     for(;;) {
       acia_puts("*NEXT\n");
-      acia_gets(readline_buffer, 255);
+      acia_gets(readline_buffer, READLINE_MAX_CHARS);
       if (strncmp("*EOF", readline_buffer, 4) == 0) {
         break;
       } else if (strncmp("!NOTFOUND", readline_buffer, 9) == 0) {
         lcd_put_newline();
         syntax_error_msg("File not found");
         break;
+      } else if (strncmp("!TOOLONG", readline_buffer, 8) == 0) {
+        lcd_put_newline();
+        syntax_error_msg("Line too long");
+        break;
       } else {
         lcd_putc('.');
-        interpret(readline_buffer);
+        if (s = expand_line(readline_buffer, &previous)) {
+          interpret(s);
+        }
       }
     }
     if (! error) {
@@ -966,6 +1892,101 @@ void cmd_load(char *args) {
   }
 }
 
+/**
+ * Compressed program lines on the serial line (SAVE and LOAD):
+ * A line starts with TRANSFER_TOKEN + <delta> if the line number is 1..127
+ * above the previous one, otherwise with TRANSFER_TOKEN <number> ' '. Every
+ * keyword at the start of a statement is replaced by TRANSFER_TOKEN + its
+ * index in keywords[], the space behind it is removed. Lines that start with
+ * a digit are uncompressed. Program text never contains bytes >= 0x80 in
+ * compressed lines, lines with such characters are sent uncompressed.
+ */
+
+/**
+ * Write the compressed 'line' into 'buffer', 'previous' is the number of the
+ * line sent before.
+ */
+void compress_line(char *buffer, program_line *line, unsigned int previous) {
+  char *args = line->args;
+  unsigned char command = line->command;
+  unsigned int delta = line->number - previous;
+  char *start = buffer;
+  if (line->number > previous && delta < 0x80) {
+    *buffer++ = TRANSFER_TOKEN + delta;
+  } else {
+    buffer += sprintf(buffer, "%c%u ", TRANSFER_TOKEN, line->number);
+  }
+  for (;;) {
+    *buffer++ = TRANSFER_TOKEN + command;
+    if (command_functions[command] == cmd_on) {
+      ++args;
+    }
+    while (*args) {
+      if ((unsigned char) *args >= TRANSFER_TOKEN) {
+        format_line(start, line);
+        return;
+      }
+      *buffer++ = *args++;
+    }
+    ++args;
+    command = *args;
+    if (command == CMD_UNKNOWN) {
+      *buffer = '\0';
+      return;
+    }
+    ++args;
+    *buffer++ = ':';
+  }
+}
+
+/**
+ * Expand the received line 's' into parsebuf if it is compressed and return
+ * the program line text. 'previous' holds the number of the last line.
+ * Return NULL with an error if the line contains an invalid token or doesn't
+ * fit into parsebuf.
+ */
+char *expand_line(char *s, unsigned int *previous) {
+  char *out = parsebuf;
+  char *end = parsebuf + sizeof(parsebuf) - 1;
+  const char *keyword;
+  unsigned char c = *s;
+  if (c < TRANSFER_TOKEN) {
+    *previous = atoi(s);
+    return s;
+  }
+  ++s;
+  if (c == TRANSFER_TOKEN) {
+    *previous = atoi(s);
+  } else {
+    *previous += c - TRANSFER_TOKEN;
+  }
+  out += sprintf(out, "%u ", *previous);
+  if (c == TRANSFER_TOKEN) {
+    while (isdigit(*s)) {
+      ++s;
+    }
+    s = skip_whitespace(s);
+  }
+  while (c = *s++) {
+    if (c >= TRANSFER_TOKEN + KEYWORD_COUNT) {
+      syntax_error_msg("Invalid token");
+      return NULL;
+    }
+    keyword = c >= TRANSFER_TOKEN ? keywords[c - TRANSFER_TOKEN] : NULL;
+    if (out + (keyword ? strlen(keyword) + 1 : 1) > end) {
+      syntax_error_msg("Line too long");
+      return NULL;
+    }
+    if (keyword) {
+      out += sprintf(out, "%s ", keyword);
+    } else {
+      *out++ = c;
+    }
+  }
+  *out = '\0';
+  return parsebuf;
+}
+
 /**
  * List all programs stored on the terminal host over the serial line.
  * DIR
@@ -1012,10 +2033,14 @@ void cmd_sleep(char *args) {
   if (isdigit(args[0])) {
     sscanf(args, "%ul", &delay);
     sleep_end_millis = time_millis() + delay;
+    acia_flush();
     while (time_millis() < sleep_end_millis) {
       if (is_interrupted()) {
         break;
       }
+      if (console_active()) {
+        console_update();
+      }
     }
   } else {
     syntax_error();
@@ -1039,17 +2064,21 @@ void cmd_home(char *) {
 }
 
 /**
- * Start the synthesizer program.
+ * Start the synthesizer program and print the measured worst case latency
+ * from a key press to the note (two scan loops, see sid.s65).
  * SYNTH
  */
 void cmd_synth(char *) {
+  unsigned int cycles;
   lcd_clear();
-  lcd_puts("ESC to quit\n");
-  lcd_puts("Play sounds with these keys:\n");
+  lcd_puts("ESC quit, 1-4 waveform, 5-8 envelope\n");
+  lcd_puts("Play chords with these keys:\n");
   lcd_puts(" W E   T Z U   O P\n");
   lcd_puts("A S D F G H J K L");
-  sid_synth();
+  cycles = sid_synth();
   lcd_clear();
+  sprintf(print_buffer, "Key latency < %u us\n", cycles * 2);
+  lcd_puts(print_buffer);
 }
 
 /**
@@ -1057,7 +2086,6 @@ void cmd_synth(char *) {
  * List all variables if no arguments are given.
  */
 void cmd_let(char *args) {
-  unsigned char token;
   unsigned int var_name;
   unsigned char var_type;
 
@@ -1070,9 +2098,8 @@ void cmd_let(char *args) {
   }
 
   if (args = parse_variable(args, &var_name, &var_type)) {
-    if (next_token(args) == TOKEN_ASSIGN) {
-      token = next_token(args);
-      args = consume_token(args, token);
+    if (lex(args) == TOKEN_ASSIGN) {
+      args = lex_ptr;
       switch (var_type) {
         case VAR_TYPE_INTEGER: {
           int value;
@@ -1091,6 +2118,7 @@ void cmd_let(char *args) {
       }
     } else {
       if (*args == '\0') {
+        compiler_free();
         delete_variable(var_name, var_type);
       }
     }
@@ -1103,6 +2131,11 @@ void cmd_let(char *args) {
  * Delete all variables.
  */
 void cmd_clear(char *) {
+  unsigned char n;
+  compiler_free();
+  for (n = 1; n < MAX_TASKS; ++n) {
+    free_variables(&tasks[n].variables);
+  }
   clear_variables();
   print_ready();
 }
@@ -1115,6 +2148,10 @@ void cmd_input(char *args) {
   unsigned int var_name;
   unsigned char var_type;
 
+  if (idle_task) {
+    syntax_error_msg("Input busy");
+    return;
+  }
   args = parse_variable(args, &var_name, &var_type);
   if (args) {
     if (var_type == VAR_TYPE_STRING) {
@@ -1131,8 +2168,8 @@ void cmd_input(char *args) {
           create_variable(var_name, var_type, &value);
           break;
         } else {
-          if (next_token(args) == TOKEN_ONERROR) {
-            args = consume_token(args, TOKEN_ONERROR);
+          if (lex(args) == TOKEN_ONERROR) {
+            args = lex_ptr;
             execute(args);
             break;
           } else {
@@ -1175,9 +2212,9 @@ void cmd_at(char *args) {
     return;
   }
 
-  if (next_token(args) == TOKEN_COMMA) {
-    args = consume_token(args, TOKEN_COMMA);
-    if ((token = next_token(args)) == TOKEN_VAR_STRING) {
+  if (lex(args) == TOKEN_COMMA) {
+    args = lex_ptr;
+    if ((token = lex(args)) == TOKEN_VAR_STRING) {
       unsigned int var_name;
       unsigned char var_type;
       if (args = parse_variable(args, &var_name, &var_type)) {
@@ -1209,18 +2246,22 @@ void cmd_cursor(char *args) {
 
 /**
  * Seed the random number generator (e.g. SEED TI).
- * SEED <number>
+ * Without an argument, the seed is taken from the SID noise generator.
+ * SEED [<number>]
  */
 void cmd_seed(char *args) {
   int seed;
-  if (parse_number_expression(args, &seed)) {
-    srand(seed);
+  if (lex(args) == TOKEN_END) {
+    math_seed_sid();
+  } else if (parse_number_expression(args, &seed)) {
+    math_srand(seed);
   }
 }
 
 /**
- * Conditional execution of a command.
- * IF <condition> THEN <command>
+ * Conditional execution of a command. If the condition is false, the
+ * remaining statements of the line are skipped too.
+ * IF <condition> THEN <command> [: <command> ...]
  */
 void cmd_if(char *args) {
   int condition;
@@ -1229,6 +2270,8 @@ void cmd_if(char *args) {
       if (args = consume_token(args, TOKEN_THEN)) {
         execute(args);
       }
+    } else {
+      skip_statements = 1;
     }
   }
 }
@@ -1250,22 +2293,12 @@ void cmd_end(char *) {
  * EDIT <line>
  */
 void cmd_edit(char *args) {
-  unsigned int line_number;
   program_line *line;
-  if (isdigit(args[0])) {
-    sscanf(args, "%u", &line_number);
-    line = program;
-    while (line) {
-      if (line->number == line_number) {
-        sprintf(readline_buffer, "%u %s %s", line->number, keywords[line->command], line->args);
-        readline_reedit();
-        return;
-      }
-      line = line->next;
-    }
-    syntax_error_msg("Line not found");
-  } else {
-    syntax_error();
+  if (line = parse_line_number(args)) {
+    format_line(tmpbuf, line);
+    strncpy(readline_buffer, tmpbuf, READLINE_MAX_CHARS);
+    readline_buffer[READLINE_MAX_CHARS] = '\0';
+    readline_reedit();
   }
 }
 
@@ -1291,3 +2324,579 @@ void cmd_write(char *args) {
     }
   }
 }
+
+/**
+ * Send the cycle counts of the profiled routines over the serial line and
+ * reset them. Only available if the firmware was built with PROFILE=1.
+ * PROFILE
+ */
+void cmd_profile(char *) {
+#ifdef PROFILE
+  profile_dump();
+  profile_clear();
+#else
+  syntax_error_msg("Profiler not included");
+#endif
+}
+
+/**
+ * Compile the program into threaded code that is executed by RUN until the
+ * program or the variables are changed (see compiler.c).
+ * COMPILE
+ */
+void cmd_compile(char *) {
+  unsigned int size;
+  if (overlay_blocks) {
+    syntax_error_msg("Not in overlay mode");
+    return;
+  }
+  size = compile_program();
+  if (size) {
+    sprintf(print_buffer, "%u bytes compiled.\n", size);
+    lcd_puts(print_buffer);
+  }
+}
+
+/**
+ * Write a byte into memory.
+ * POKE <address>, <value>
+ */
+void cmd_poke(char *args) {
+  int values[2];
+  if (parse_number_list(args, values, 2)) {
+    if (values[1] < 0 || values[1] > 255) {
+      syntax_error_invalid_argument();
+      return;
+    }
+    *((unsigned char *) values[0]) = values[1];
+  }
+}
+
+/**
+ * Read a byte from memory into an integer variable.
+ * PEEK <address>, <variable>
+ */
+void cmd_peek(char *args) {
+  int address;
+  int value;
+  unsigned int var_name;
+  unsigned char var_type;
+
+  if (! (args = parse_number_expression(args, &address))) {
+    return;
+  }
+  if (! (args = consume_token(args, TOKEN_COMMA))) {
+    return;
+  }
+  if (parse_variable(args, &var_name, &var_type) && var_type == VAR_TYPE_INTEGER) {
+    value = *((unsigned char *) address);
+    create_variable(var_name, var_type, &value);
+  } else {
+    syntax_error_invalid_argument();
+  }
+}
+
+/**
+ * Call a machine code routine, it must return with RTS.
+ * SYS <address>
+ */
+void cmd_sys(char *args) {
+  int address;
+  if (parse_number_expression(args, &address)) {
+    ((void (*)()) address)();
+  }
+}
+
+/**
+ * Copy a memory block (the blocks may overlap).
+ * MEMCPY <destination>, <source>, <count>
+ */
+void cmd_memcpy(char *args) {
+  int values[3];
+  if (parse_number_list(args, values, 3)) {
+    memmove((void *) values[0], (void *) values[1], values[2]);
+  }
+}
+
+/**
+ * Fill a memory block with a byte value.
+ * MEMFILL <address>, <count>, <value>
+ */
+void cmd_memfill(char *args) {
+  int values[3];
+  if (parse_number_list(args, values, 3)) {
+    if (values[2] < 0 || values[2] > 255) {
+      syntax_error_invalid_argument();
+      return;
+    }
+    memset((void *) values[0], values[2], values[1]);
+  }
+}
+
+/**
+ * Load a binary file from the terminal host with the XMODEM-CRC protocol into
+ * the user RAM region (see firmware.cfg), by default at its start.
+ * BLOAD "<filename>" [, <address>]
+ */
+void cmd_bload(char *args) {
+  char *filename;
+  int address = (int) USER_RAM_START;
+  unsigned long size;
+  unsigned char result;
+
+  if (! (args = parse_string_expression(args, &filename))) {
+    syntax_error_invalid_argument();
+    return;
+  }
+  if (lex(args) == TOKEN_COMMA) {
+    if (! parse_number_expression(lex_ptr, &address)) {
+      return;
+    }
+  }
+  if ((unsigned char *) address < USER_RAM_START ||
+      (unsigned char *) address >= USER_RAM_START + USER_RAM_SIZE) {
+    syntax_error_invalid_argument();
+    return;
+  }
+
+  lcd_puts("Loading...");
+  acia_puts("*BLOAD \"");
+  acia_puts(filename);
+  acia_puts("\"\n");
+  acia_gets(readline_buffer, 255);
+  lcd_put_newline();
+  if (strncmp("*XMODEM ", readline_buffer, 8) != 0) {
+    syntax_error_msg("File not found");
+    return;
+  }
+  size = strtoul(readline_buffer + 8, NULL, 10);
+  if (size > (unsigned int) (USER_RAM_START + USER_RAM_SIZE - (unsigned char *) address)) {
+    acia_putc(XMODEM_CAN);
+    syntax_error_msg("File too large");
+    return;
+  }
+
+  result = xmodem_receive((unsigned char *) address, size);
+  if (result == XMODEM_OK) {
+    sprintf(print_buffer, "%u bytes loaded.\n", (unsigned int) size);
+    lcd_puts(print_buffer);
+    print_ready();
+  } else if (result == XMODEM_CANCELED) {
+    syntax_error_msg("Transfer canceled");
+  } else {
+    syntax_error_msg("Transfer failed");
+  }
+}
+
+/**
+ * Run a program that stays on the terminal host and is fetched in blocks of
+ * lines on demand (see overlay.c). Without a filename the number of block
+ * lookups that were served from memory and from the host is printed.
+ * OVERLAY ["<filename>"]
+ */
+void cmd_overlay(char *args) {
+  char *filename;
+  if (*args == '\0') {
+    sprintf(print_buffer, "Hits %u, misses %u\n", overlay_hits, overlay_misses);
+    lcd_puts(print_buffer);
+    return;
+  }
+  if (parse_string_expression(args, &filename)) {
+    cmd_new(0);
+    if (overlay_open(filename)) {
+      sprintf(print_buffer, "%u blocks.\n", overlay_blocks);
+      lcd_puts(print_buffer);
+      print_ready();
+    }
+  } else {
+    syntax_error_invalid_argument();
+  }
+}
+
+/**
+ * Switch to the serial console (input and output over the serial line), the
+ * LCD is redrawn every <interval> milliseconds if given. Or switch back to the
+ * LCD and the keyboard.
+ * CONSOLE ON [<interval>] | OFF
+ */
+void cmd_console(char *args) {
+  int interval = 0;
+  if (strncmp("on", args, 2) == 0) {
+    args = skip_whitespace(args + 2);
+    if (*args && ! parse_number_expression(args, &interval)) {
+      return;
+    }
+    if (interval < 0) {
+      syntax_error_invalid_argument();
+      return;
+    }
+    console_on(interval);
+    print_ready();
+  } else if (strcmp("off", args) == 0) {
+    console_off();
+    print_ready();
+  } else {
+    syntax_error();
+  }
+}
+
+/**
+ * Fill a screen region with a character, given as a string or a character code.
+ * FILL <x>, <y>, <width>, <height>, "<c>" | <code>
+ */
+void cmd_fill(char *args) {
+  int values[4];
+  int c;
+  char *string;
+  unsigned char token;
+
+  if (! (args = parse_number_list(args, values, 4))) {
+    return;
+  }
+  if (! (args = consume_token(args, TOKEN_COMMA))) {
+    return;
+  }
+  token = lex(args);
+  if (token == TOKEN_STRING || token == TOKEN_VAR_STRING) {
+    if (! parse_string_expression(args, &string)) {
+      return;
+    }
+    c = *string;
+  } else if (! parse_number_expression(args, &c)) {
+    return;
+  }
+  if (! screen_region_valid(values[0], values[1], values[2], values[3]) || c < 0 || c > 255) {
+    syntax_error_invalid_argument();
+    return;
+  }
+  screen_fill(values[0], values[1], values[2], values[3], c);
+}
+
+/**
+ * Copy a screen region (the regions may overlap).
+ * COPY <x>, <y>, <width>, <height>, <to x>, <to y>
+ */
+void cmd_copy(char *args) {
+  int values[6];
+  if (parse_number_list(args, values, 6)) {
+    if (! screen_region_valid(values[0], values[1], values[2], values[3]) ||
+        ! screen_region_valid(values[4], values[5], values[2], values[3])) {
+      syntax_error_invalid_argument();
+      return;
+    }
+    screen_copy(values[0], values[1], values[2], values[3], values[4], values[5]);
+  }
+}
+
+/**
+ * Scroll the screen or a region of it by one character.
+ * SCROLL up|down|left|right [<x>, <y>, <width>, <height>]
+ */
+void cmd_scroll(char *args) {
+  static const char *directions[] = { "up", "down", "left", "right" };
+  int values[4] = { 0, 0, 40, 4 };
+  unsigned char direction;
+  unsigned char length;
+
+  for (direction = 0; direction < 4; ++direction) {
+    length = strlen(directions[direction]);
+    if (strncmp(directions[direction], args, length) == 0) {
+      break;
+    }
+  }
+  if (direction == 4) {
+    syntax_error();
+    return;
+  }
+  args = skip_whitespace(args + length);
+  if (*args && ! parse_number_list(args, values, 4)) {
+    return;
+  }
+  if (! screen_region_valid(values[0], values[1], values[2], values[3])) {
+    syntax_error_invalid_argument();
+    return;
+  }
+  screen_scroll(values[0], values[1], values[2], values[3], direction);
+}
+
+/**
+ * Read the character code at a screen position into an integer variable.
+ * SCR <x>, <y>, <variable>
+ */
+void cmd_scr(char *args) {
+  int values[2];
+  int value;
+  unsigned int var_name;
+  unsigned char var_type;
+
+  if (! (args = parse_number_list(args, values, 2))) {
+    return;
+  }
+  if (! screen_region_valid(values[0], values[1], 1, 1)) {
+    syntax_error_invalid_argument();
+    return;
+  }
+  if (! (args = consume_token(args, TOKEN_COMMA))) {
+    return;
+  }
+  if (parse_variable(args, &var_name, &var_type) && var_type == VAR_TYPE_INTEGER) {
+    value = (unsigned char) lcd_getc(values[0], values[1]);
+    create_variable(var_name, var_type, &value);
+  } else {
+    syntax_error_invalid_argument();
+  }
+}
+
+/**
+ * Constant items for READ, they are parsed once into a pool (see data.c).
+ * DATA <integer> | "<string>" {, <integer> | "<string>"}
+ */
+void cmd_data(char *) {
+}
+
+/**
+ * Read the next DATA items into variables.
+ * READ <variable> {, <variable>}
+ */
+void cmd_read(char *args) {
+  unsigned int var_name;
+  unsigned char var_type;
+  int integer;
+  char *string;
+
+  if (overlay_blocks) {
+    syntax_error_msg("Not in overlay mode");
+    return;
+  }
+  for (;;) {
+    if (! (args = parse_variable(args, &var_name, &var_type))) {
+      syntax_error_invalid_argument();
+      return;
+    }
+    if (var_type == VAR_TYPE_STRING) {
+      if (! data_read(var_type, &string)) {
+        return;
+      }
+      create_variable(var_name, var_type, string);
+    } else {
+      if (! data_read(var_type, &integer)) {
+        return;
+      }
+      create_variable(var_name, var_type, &integer);
+    }
+    if (error || lex(args) == TOKEN_END) {
+      return;
+    }
+    if (! (args = consume_token(args, TOKEN_COMMA))) {
+      return;
+    }
+  }
+}
+
+/**
+ * Continue READ with the first DATA line (with a number >= <line>).
+ * RESTORE [<line>]
+ */
+void cmd_restore(char *args) {
+  int number = 0;
+  if (overlay_blocks) {
+    syntax_error_msg("Not in overlay mode");
+    return;
+  }
+  if (*args && ! parse_number_expression(args, &number)) {
+    return;
+  }
+  data_restore(number);
+}
+
+/**
+ * Set a breakpoint, remove all breakpoints or list them.
+ * BREAK [<line> | OFF]
+ */
+void cmd_break(char *args) {
+  program_line *line;
+  if (overlay_blocks) {
+    syntax_error_msg("Not in overlay mode");
+    return;
+  }
+  if (strcmp("off", args) == 0) {
+    for (line = program; line; line = line->next) {
+      line->flags &= ~LINE_FLAG_BREAK;
+    }
+    breakpoints = 0;
+  } else if (*args) {
+    if ((line = parse_line_number(args)) && ! (line->flags & LINE_FLAG_BREAK)) {
+      line->flags |= LINE_FLAG_BREAK;
+      ++breakpoints;
+    }
+  } else {
+    for (line = program; line; line = line->next) {
+      if (line->flags & LINE_FLAG_BREAK) {
+        sprintf(print_buffer, "%u\n", line->number);
+        lcd_puts(print_buffer);
+      }
+    }
+  }
+}
+
+/**
+ * Execute the next line of the stopped program (or the first line) and stop.
+ * STEP
+ */
+void cmd_step(char *) {
+  if (stopped) {
+    continue_program(1);
+  } else {
+    start_program();
+    debug_lines(1, 1);
+    print_ready();
+  }
+}
+
+/**
+ * Continue the program after a breakpoint, STEP or an interruption.
+ * CONT
+ */
+void cmd_cont(char *) {
+  continue_program(0);
+}
+
+/**
+ * Stop the program behind a line that changed a variable, remove all watches
+ * or list the watched variables.
+ * WATCH [<variable> | OFF]
+ */
+void cmd_watch(char *args) {
+  variable *v;
+  unsigned int var_name;
+  unsigned char var_type;
+  int zero = 0;
+
+  if (strcmp("off", args) == 0) {
+    for (v = variables; v; v = v->next) {
+      v->type &= ~VAR_FLAG_WATCH;
+    }
+    watches = 0;
+  } else if (*args) {
+    if (! parse_variable(args, &var_name, &var_type)) {
+      syntax_error_invalid_argument();
+      return;
+    }
+    if (! (v = find_variable(var_name, var_type, NULL))) {
+      create_variable(var_name, var_type, var_type == VAR_TYPE_STRING ? (void *) "" : &zero);
+      if (! (v = find_variable(var_name, var_type, NULL))) {
+        return;
+      }
+    }
+    if (v->type & VAR_FLAG_BUILTIN) {
+      syntax_error_msg("Cannot watch builtin!");
+    } else if (! (v->type & VAR_FLAG_WATCH)) {
+      v->type |= VAR_FLAG_WATCH;
+      ++watches;
+    }
+  } else {
+    for (v = variables; v; v = v->next) {
+      if (v->type & VAR_FLAG_WATCH) {
+        print_variable_assignment(v);
+      }
+    }
+  }
+}
+
+/**
+ * Record the input lines and the values of rn, ti, ti$ and us read by running
+ * programs into a file on the terminal host or stop recording.
+ * RECORD "<filename>" | OFF
+ */
+void cmd_record(char *args) {
+  char *filename;
+  if (strcmp("off", args) == 0) {
+    replay_stop();
+  } else if (parse_string_expression(args, &filename)) {
+    replay_start(REPLAY_RECORD, filename);
+  } else {
+    syntax_error_invalid_argument();
+  }
+}
+
+/**
+ * Replay a recording made with RECORD: running programs get their input
+ * lines and the values of rn, ti, ti$ and us from the recording.
+ * REPLAY "<filename>" | OFF
+ */
+void cmd_replay(char *args) {
+  char *filename;
+  if (strcmp("off", args) == 0) {
+    replay_stop();
+  } else if (parse_string_expression(args, &filename)) {
+    replay_start(REPLAY_PLAY, filename);
+  } else {
+    syntax_error_invalid_argument();
+  }
+}
+
+/**
+ * Start a task that runs the program from <line> alongside the main program.
+ * The tasks take turns every TASK_SLICE_LINES lines, while a task waits in
+ * INPUT the background tasks keep running. Every task has its own GOSUB stack
+ * and LCD cursor. A task sees the variables of the main program, the variables
+ * it creates are private and deleted when it ends.
+ * A task ends at END or behind the last line, the program ends when the main
+ * program ends.
+ * TASK <line>
+ */
+void cmd_task(char *args) {
+  program_line *line;
+  unsigned char n;
+
+  if (overlay_blocks) {
+    syntax_error_msg("Not in overlay mode");
+    return;
+  }
+  if (! (line = parse_line_number(args))) {
+    return;
+  }
+  for (n = 1; n < MAX_TASKS && tasks[n].active; ++n) {
+  }
+  if (n == MAX_TASKS) {
+    syntax_error_msg("Too many tasks");
+    return;
+  }
+  if (! (tasks[n].gosub_stack = malloc(GOSUB_STACK_SIZE * sizeof(return_address)))) {
+    syntax_error_msg("Out of memory");
+    return;
+  }
+  tasks[n].line = line;
+  tasks[n].statement = NULL;
+  tasks[n].gosub_depth = 0;
+  tasks[n].variables = NULL;
+  tasks[n].active = 1;
+  tasks[n].x = lcd_get_x();
+  tasks[n].y = lcd_get_y();
+  ++background_tasks;
+}
+
+/**
+ * Define the bitmap of the user defined character <n> (0..7). It is shown as
+ * character code 8 + <n>, e.g. with FILL.
+ * <b0>..<b7> are the pixel rows from top to bottom, bit 4 is the leftmost
+ * pixel. Redefining a character changes all its instances on the screen.
+ * DEFCHAR <n>, <b0>, <b1>, <b2>, <b3>, <b4>, <b5>, <b6>, <b7>
+ */
+void cmd_defchar(char *args) {
+  int values[9];
+  unsigned char bitmap[8];
+  unsigned char i;
+
+  if (! parse_number_list(args, values, 9)) {
+    return;
+  }
+  if (values[0] < 0 || values[0] > 7) {
+    syntax_error_invalid_argument();
+    return;
+  }
+  for (i = 0; i < 8; ++i) {
+    bitmap[i] = values[i + 1] & 0x1f;
+  }
+  lcd_define_char(values[0], bitmap);
+}
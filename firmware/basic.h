@@ -2,10 +2,76 @@
 #define _BASIC_H
 
 extern void basic_init();
+extern unsigned char basic_autostart();
 extern void interpret(char * s);
 extern void syntax_error();
 extern void syntax_error_msg_with_arg(const char *msg, const char *msg_arg);
 #define syntax_error_msg(s) syntax_error_msg_with_arg(s, NULL)
+extern unsigned int program_size();
 extern char print_buffer[];
 
+// Interpreter internals used by the compiler and the overlays (see compiler.c, overlay.c)
+
+// Return value of find_keyword() if the keyword wasn't found
+#define CMD_UNKNOWN 0xFF
+
+// Basic command function type
+typedef void (* command_function) ();
+
+// Flags of a program line
+#define LINE_FLAG_BREAK 0x01
+
+// The arguments of an ON statement in a program line start with a slot byte,
+// JUMP_SLOT + the index of its jump table (see cmd_on())
+#define JUMP_SLOT 0x80
+#define skip_jump_slot(args) ((unsigned char) *(args) >= JUMP_SLOT ? (args) + 1 : (args))
+
+// Data structure holding one line of BASIC code
+typedef struct _program_line {
+  unsigned int number;
+  unsigned char command;
+  unsigned char flags;
+  char * args;
+  struct _program_line * next;
+} program_line;
+
+extern const command_function command_functions[];
+extern program_line * program;
+extern program_line * current_line;
+extern unsigned char running;
+extern unsigned char error;
+
+extern program_line *find_line(unsigned int number);
+extern void create_line(unsigned int number, char *s);
+extern void delete_line(unsigned int number);
+extern unsigned char line_in_use(unsigned int first, unsigned int last);
+extern char *parse_number_expression(char *s, int *value);
+extern char *parse_variable(char *s, unsigned int *name, unsigned char *type);
+extern char *skip_whitespace(char *s);
+extern char *find_args(char *s);
+extern unsigned char find_keyword(char *s);
+extern void print_interrupted();
+
+// Number of tasks started with TASK besides the main program
+extern unsigned char background_tasks;
+extern void run_idle_task();
+
+extern void cmd_goto(char *args);
+extern void cmd_gosub(char *args);
+extern void cmd_return(char *args);
+extern void cmd_on(char *args);
+extern void cmd_if(char *args);
+extern void cmd_end(char *args);
+extern void cmd_let(char *args);
+extern void cmd_rem(char *args);
+extern void cmd_run(char *args);
+extern void cmd_new(char *args);
+extern void cmd_load(char *args);
+extern void cmd_clear(char *args);
+extern void cmd_compile(char *args);
+extern void cmd_overlay(char *args);
+extern void cmd_data(char *args);
+extern void cmd_input(char *args);
+extern void cmd_task(char *args);
+
 #endif
@@ -0,0 +1,43 @@
+#include "lcd.h"
+#include "acia.h"
+#include "keys.h"
+
+// Benchmark for the driver entry points of the 6502 and the 65C02 build, run
+// with sim65 -c (see Makefile). Build with one of OP_NONE, OP_LCD_PUTC,
+// OP_ACIA_BUFFER_PUTC and OP_KEYS_UPDATE.
+// The I/O registers are plain memory in sim65: the ACIA always reports an
+// empty transmitter and no key is pressed, so the drivers never wait.
+
+#define ITERATIONS 1000
+
+#define ACIA_STATUS (*(unsigned char *) 0x7f01)
+#define ACIA_STATUS_TX_EMPTY 0x10
+#define VIA2_IRA (*(unsigned char *) 0x7f41)
+
+int result;
+
+int main() {
+  int i;
+
+  lcd_mode = LCD_MODE_DEFERRED;
+  ACIA_STATUS = ACIA_STATUS_TX_EMPTY;
+  VIA2_IRA = 0xff;
+
+  for (i = 0; i < ITERATIONS; ++i) {
+#if defined(OP_LCD_PUTC)
+    // Running text, a line wraps every 40 and the screen scrolls every 160
+    // characters
+    lcd_putc('a' + (i & 15));
+#elif defined(OP_ACIA_BUFFER_PUTC)
+    // Lines of 63 characters, the newline sends the buffer
+    acia_buffer_putc((i & 63) == 63 ? '\n' : 'a');
+#elif defined(OP_KEYS_UPDATE)
+    // Scan of all rows without a pressed key
+    keys_update();
+#else
+    result = i;
+#endif
+  }
+
+  return 0;
+}
@@ -0,0 +1,69 @@
+#include <stdlib.h>
+#include "fastmath.h"
+
+// Benchmark for the math kernel, run with sim65 -c (see Makefile).
+// Build with one of OP_NONE, OP_MUL, OP_DIV, OP_MOD, OP_RAND and optionally
+// USE_FASTMATH to measure the kernel instead of the cc65 runtime.
+
+#define ITERATIONS 1000
+
+#ifdef USE_FASTMATH
+#define MUL(a, b) math_mul(a, b)
+#define DIV(a, b) math_div(a, b)
+#define MOD(a, b) math_mod(a, b)
+#define RAND() math_rand()
+#else
+#define MUL(a, b) ((a) * (b))
+#define DIV(a, b) ((a) / (b))
+#define MOD(a, b) ((a) % (b))
+#define RAND() rand()
+#endif
+
+int result;
+
+/**
+ * Compare the kernel with the C operators for a few typical operands.
+ * Return 1 if all results match.
+ */
+unsigned char check() {
+  static const int values[] = { 0, 1, 3, 4, 7, 40, 41, 100, 255, 256, 1000, -1, -7, -40, -1000, 32767 };
+  unsigned char i;
+  unsigned char j;
+  for (i = 0; i < sizeof(values) / sizeof(int); ++i) {
+    for (j = 0; j < sizeof(values) / sizeof(int); ++j) {
+      int a = values[i];
+      int b = values[j];
+      if (math_mul(a, b) != a * b) {
+        return 0;
+      }
+      if (b != 0 && (math_div(a, b) != a / b || math_mod(a, b) != a % b)) {
+        return 0;
+      }
+    }
+  }
+  return 1;
+}
+
+int main() {
+  int i;
+
+  if (! check()) {
+    return 1;
+  }
+
+  for (i = 0; i < ITERATIONS; ++i) {
+#if defined(OP_MUL)
+    result = MUL(i, 41);
+#elif defined(OP_DIV)
+    result = DIV(i + 41, 40);
+#elif defined(OP_MOD)
+    result = MOD(i + 41, 40);
+#elif defined(OP_RAND)
+    result = RAND();
+#else
+    result = i;
+#endif
+  }
+
+  return 0;
+}
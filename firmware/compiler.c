@@ -0,0 +1,594 @@
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include "lcd.h"
+#include "basic.h"
+#include "lexer.h"
+#include "variables.h"
+#include "compiler.h"
+
+/*
+ * The compiler translates the program into direct-threaded 6502 code. Every
+ * line starts with a call of the rt_line primitive, statements become calls of
+ * primitives (see threaded.s65) followed by their pre-decoded operands:
+ *
+ *   JSR rt_line .word <program_line>
+ *   JSR rt_command .word <command function>, <args>
+ *   JSR rt_if .word <next line>
+ *   JSR rt_gosub .word <line>
+ *   JSR rt_on_goto|rt_on_gosub .byte <n> .word <line 1> ... <line n>
+ *   JSR rt_eval .word <expression text>
+ *   JSR rt_builtin .word <builtin function>
+ *   JSR rt_error .word <message>
+ *
+ * GOTO becomes a JMP to the line, RETURN an RTS and END a JMP to rt_end.
+ * Jumps to missing lines go to rt_line_not_found.
+ * Number expressions are evaluated in compiled_acc: constants and variables
+ * are loaded inline into compiled_acc or compiled_arg, + and - are inlined and
+ * the other operators are subroutine calls. Expressions with strings are
+ * left to the interpreter (rt_eval). Integer variables are created when the
+ * program is compiled, so the code can access their values directly.
+ */
+
+// 6502 opcodes
+#define OP_CLC 0x18
+#define OP_JSR 0x20
+#define OP_SEC 0x38
+#define OP_JMP 0x4c
+#define OP_RTS 0x60
+#define OP_ADC_ZP 0x65
+#define OP_STA_ZP 0x85
+#define OP_STA_ABS 0x8d
+#define OP_LDA_ZP 0xa5
+#define OP_LDA_IMM 0xa9
+#define OP_LDA_ABS 0xad
+#define OP_SBC_ZP 0xe5
+
+// Maximum number of targets of an ON ... GOTO/GOSUB statement
+#define MAX_ON_TARGETS 32
+
+// Operands of a rt_command call
+typedef struct _compiled_call {
+  command_function function;
+  char * args;
+} compiled_call;
+
+// Expression registers of the threaded code
+extern int compiled_acc;
+#pragma zpsym("compiled_acc");
+extern int compiled_arg;
+#pragma zpsym("compiled_arg");
+
+// Threaded code primitives (see threaded.s65)
+extern void __fastcall__ compiled_execute(unsigned char *code);
+extern void rt_line();
+extern void rt_command();
+extern void rt_eval();
+extern void rt_builtin();
+extern void rt_if();
+extern void rt_gosub();
+extern void rt_on_goto();
+extern void rt_on_gosub();
+extern void rt_end();
+extern void rt_error();
+extern void rt_line_not_found();
+extern void rt_mul();
+extern void rt_div();
+extern void rt_mod();
+extern void rt_equal();
+extern void rt_notequal();
+extern void rt_less();
+extern void rt_lessequal();
+extern void rt_greater();
+extern void rt_greaterequal();
+
+// Subroutines of the operators TOKEN_MUL .. TOKEN_GREATEREQUAL (NULL for ',')
+void (* const operator_primitives[])() = {
+  rt_mul, rt_div, rt_mod, NULL, rt_equal, rt_notequal,
+  rt_less, rt_lessequal, rt_greater, rt_greaterequal
+};
+
+// The compiled program or NULL if the program isn't compiled or was changed
+unsigned char *compiled_code = NULL;
+
+// Output buffer of the compiler (NULL while the code size is determined)
+unsigned char *code;
+
+// Current output offset of the compiler
+unsigned int code_offset;
+
+// Code offset of each program line (and of the end of the program)
+unsigned int *line_offsets;
+
+// True if the program contains a statement that can't be compiled
+unsigned char compile_failed;
+
+/**
+ * Append the byte 'b' to the compiled code.
+ */
+void emit_byte(unsigned char b) {
+  if (code) {
+    code[code_offset] = b;
+  }
+  ++code_offset;
+}
+
+/**
+ * Append the word 'w' to the compiled code.
+ */
+void emit_word(unsigned int w) {
+  emit_byte(w);
+  emit_byte(w >> 8);
+}
+
+/**
+ * Append a call of the primitive 'primitive'.
+ */
+void emit_call(void (* primitive)()) {
+  emit_byte(OP_JSR);
+  emit_word((unsigned int) primitive);
+}
+
+/**
+ * Append code that copies the 16-bit value 'from' into 'to'.
+ * The load and store opcodes select the addressing modes.
+ */
+void emit_copy(unsigned char load, unsigned int from, unsigned char store, unsigned int to) {
+  unsigned char i;
+  for (i = 0; i < 2; ++i) {
+    emit_byte(load);
+    if (load == OP_LDA_ABS) {
+      emit_word(from + i);
+    } else {
+      emit_byte(load == OP_LDA_IMM ? (i ? from >> 8 : from) : from + i);
+    }
+    emit_byte(store);
+    if (store == OP_STA_ABS) {
+      emit_word(to + i);
+    } else {
+      emit_byte(to + i);
+    }
+  }
+}
+
+/**
+ * Append code for the operator 'token' that combines compiled_acc and
+ * compiled_arg into compiled_acc.
+ */
+void emit_operator(unsigned char token) {
+  unsigned char i;
+  if (token == TOKEN_PLUS || token == TOKEN_MINUS) {
+    emit_byte(token == TOKEN_PLUS ? OP_CLC : OP_SEC);
+    for (i = 0; i < 2; ++i) {
+      emit_byte(OP_LDA_ZP);
+      emit_byte((unsigned int) &compiled_acc + i);
+      emit_byte(token == TOKEN_PLUS ? OP_ADC_ZP : OP_SBC_ZP);
+      emit_byte((unsigned int) &compiled_arg + i);
+      emit_byte(OP_STA_ZP);
+      emit_byte((unsigned int) &compiled_acc + i);
+    }
+  } else {
+    emit_call(operator_primitives[token - TOKEN_MUL]);
+  }
+}
+
+/**
+ * Append the address of the compiled program line with number 'number'.
+ */
+void emit_line_address(unsigned int number) {
+  unsigned int index = 0;
+  program_line *line = program;
+  while (line) {
+    if (line->number == number) {
+      emit_word((unsigned int) code + line_offsets[index]);
+      return;
+    }
+    ++index;
+    line = line->next;
+  }
+  emit_word((unsigned int) rt_line_not_found);
+}
+
+/**
+ * Append a call of the interpreter's command function 'function' with the
+ * arguments 'args'.
+ */
+void emit_command(command_function function, char *args) {
+  emit_call(rt_command);
+  emit_word((unsigned int) function);
+  emit_word((unsigned int) args);
+}
+
+/**
+ * Return the integer variable with name 'name'. It is created if it
+ * doesn't exist yet. Return NULL if no memory is left.
+ */
+variable *compile_variable(unsigned int name) {
+  int zero = 0;
+  variable *var = find_variable(name, VAR_TYPE_INTEGER, NULL);
+  if (! var) {
+    create_variable(name, VAR_TYPE_INTEGER, &zero);
+    var = find_variable(name, VAR_TYPE_INTEGER, NULL);
+    if (! var) {
+      compile_failed = 1;
+    }
+  }
+  return var;
+}
+
+/**
+ * Return 1 if 'token' is a binary operator of number expressions.
+ */
+unsigned char is_operator(unsigned char token) {
+  return token >= TOKEN_PLUS && token <= TOKEN_GREATEREQUAL && token != TOKEN_COMMA;
+}
+
+/**
+ * Return a pointer behind the expression 's' without evaluating it.
+ */
+char *skip_expression(char *s) {
+  unsigned char token;
+  for (;;) {
+    token = lex(s);
+    if (token == TOKEN_PLUS || token == TOKEN_MINUS) {
+      token = lex(lex_ptr);
+    }
+    if (token != TOKEN_DIGITS && token != TOKEN_STRING &&
+        token != TOKEN_VAR_NUMBER && token != TOKEN_VAR_STRING) {
+      return s;
+    }
+    if (! lex_ptr) {
+      return s + strlen(s);
+    }
+    s = lex_ptr;
+    if (! is_operator(lex(s))) {
+      return s;
+    }
+    s = lex_ptr;
+  }
+}
+
+/**
+ * Append code that loads the term 's' into 'reg' (compiled_acc or compiled_arg).
+ * Return a pointer behind the term or NULL if it can't be compiled.
+ */
+char *compile_term(char *s, int *reg) {
+  variable *var;
+  unsigned char negative;
+  unsigned char token = lex(s);
+  if (token == TOKEN_PLUS || token == TOKEN_MINUS) {
+    negative = token == TOKEN_MINUS;
+    if (lex(lex_ptr) != TOKEN_DIGITS) {
+      return NULL;
+    }
+    emit_copy(OP_LDA_IMM, negative ? -lex_value : lex_value, OP_STA_ZP, (unsigned int) reg);
+    return lex_ptr;
+  }
+  if (token == TOKEN_DIGITS) {
+    emit_copy(OP_LDA_IMM, lex_value, OP_STA_ZP, (unsigned int) reg);
+    return lex_ptr;
+  }
+  if (token == TOKEN_VAR_NUMBER) {
+    s = lex_ptr;
+    if (! (var = compile_variable(lex_value))) {
+      return NULL;
+    }
+    if (var->type & VAR_FLAG_BUILTIN) {
+      emit_call(rt_builtin);
+      emit_word((unsigned int) var->value.builtin_integer);
+      if (reg == &compiled_acc) {
+        emit_copy(OP_LDA_ZP, (unsigned int) &compiled_arg, OP_STA_ZP, (unsigned int) reg);
+      }
+    } else {
+      emit_copy(OP_LDA_ABS, (unsigned int) &var->value.integer, OP_STA_ZP, (unsigned int) reg);
+    }
+    return s;
+  }
+  return NULL;
+}
+
+/**
+ * Append code that evaluates the expression 's' into compiled_acc.
+ * Expressions that can't be compiled are evaluated by the interpreter.
+ * Return a pointer behind the expression.
+ */
+char *compile_expression(char *s) {
+  unsigned int start = code_offset;
+  char *expression = s;
+  unsigned char token;
+  if (s = compile_term(s, &compiled_acc)) {
+    for (;;) {
+      token = lex(s);
+      if (! is_operator(token)) {
+        return s;
+      }
+      if (! (s = compile_term(lex_ptr, &compiled_arg))) {
+        break;
+      }
+      emit_operator(token);
+    }
+  }
+  code_offset = start;
+  emit_call(rt_eval);
+  emit_word((unsigned int) expression);
+  return skip_expression(expression);
+}
+
+void compile_statement(unsigned char command, char *args, unsigned int next_line);
+
+/**
+ * IF <condition> THEN <command>
+ */
+void compile_if(char *args, unsigned int next_line) {
+  unsigned char command;
+  args = compile_expression(args);
+  emit_call(rt_if);
+  emit_word((unsigned int) code + next_line);
+  if (lex(args) != TOKEN_THEN) {
+    emit_call(rt_error);
+    emit_word((unsigned int) "Syntax error");
+    return;
+  }
+  args = skip_whitespace(lex_ptr);
+  command = find_keyword(args);
+  if (command == CMD_UNKNOWN) {
+    compile_failed = 1;
+    return;
+  }
+  compile_statement(command, find_args(args), next_line);
+}
+
+/**
+ * ON <index> GOTO|GOSUB <line> [, <line> ...]
+ */
+void compile_on(char *args) {
+  unsigned int start = code_offset;
+  unsigned int targets[MAX_ON_TARGETS];
+  unsigned char count = 0;
+  unsigned char gosub;
+  unsigned char i;
+  char *s = skip_whitespace(compile_expression(skip_jump_slot(args)));
+
+  if (strncasecmp(s, "gosub", 5) == 0) {
+    gosub = 1;
+    s += 5;
+  } else if (strncasecmp(s, "goto", 4) == 0) {
+    gosub = 0;
+    s += 4;
+  } else {
+    count = MAX_ON_TARGETS + 1;
+  }
+  while (count < MAX_ON_TARGETS && lex(s) == TOKEN_DIGITS) {
+    targets[count++] = lex_value;
+    s = lex_ptr;
+    if (lex(s) == TOKEN_END) {
+      emit_call(gosub ? rt_on_gosub : rt_on_goto);
+      emit_byte(count);
+      for (i = 0; i < count; ++i) {
+        emit_line_address(targets[i]);
+      }
+      return;
+    }
+    if (lex(s) != TOKEN_COMMA) {
+      break;
+    }
+    s = lex_ptr;
+  }
+  // Malformed, let the interpreter report the error
+  code_offset = start;
+  emit_command(cmd_on, args);
+}
+
+/**
+ * LET <variable> = <number expression>
+ */
+void compile_let(char *args) {
+  unsigned int name;
+  unsigned char type;
+  variable *var;
+  char *s = parse_variable(args, &name, &type);
+  if (s && type == VAR_TYPE_INTEGER && lex(s) == TOKEN_ASSIGN) {
+    s = lex_ptr;
+    if (var = compile_variable(name)) {
+      if (! (var->type & VAR_FLAG_BUILTIN)) {
+        compile_expression(s);
+        emit_copy(OP_LDA_ZP, (unsigned int) &compiled_acc, OP_STA_ABS, (unsigned int) &var->value.integer);
+        return;
+      }
+    }
+  } else if (s && *skip_whitespace(s) == '\0') {
+    // Deleting variables would invalidate the compiled variable addresses
+    compile_failed = 1;
+    return;
+  }
+  emit_command(cmd_let, args);
+}
+
+/**
+ * Append the code of the statement 'command' with arguments 'args'.
+ * 'next_line' is the code offset of the following line.
+ */
+void compile_statement(unsigned char command, char *args, unsigned int next_line) {
+  command_function function = command_functions[command];
+  unsigned int number;
+  unsigned char type;
+  char *rest;
+
+  if (function == cmd_rem || function == cmd_data) {
+    return;
+  } else if (function == cmd_goto || function == cmd_gosub) {
+    if (isdigit(args[0])) {
+      sscanf(args, "%u", &number);
+      if (function == cmd_gosub) {
+        emit_call(rt_gosub);
+      } else {
+        emit_byte(OP_JMP);
+      }
+      emit_line_address(number);
+      return;
+    }
+  } else if (function == cmd_return) {
+    emit_byte(OP_RTS);
+    return;
+  } else if (function == cmd_end) {
+    emit_byte(OP_JMP);
+    emit_word((unsigned int) rt_end);
+    return;
+  } else if (function == cmd_if) {
+    compile_if(args, next_line);
+    return;
+  } else if (function == cmd_on) {
+    compile_on(args);
+    return;
+  } else if (function == cmd_let) {
+    compile_let(args);
+    return;
+  } else if (function == cmd_input) {
+    // The ONERROR statement is executed by the interpreter, the threaded code
+    // wouldn't follow a jump made there
+    if ((rest = parse_variable(args, &number, &type)) && lex(rest) == TOKEN_ONERROR) {
+      compile_failed = 1;
+      return;
+    }
+  } else if (function == cmd_run || function == cmd_new || function == cmd_load ||
+             function == cmd_clear || function == cmd_compile || function == cmd_overlay ||
+             function == cmd_task) {
+    compile_failed = 1;
+    return;
+  }
+  emit_command(function, args);
+}
+
+/**
+ * Compile all program lines into 'code' (or only determine the size if it
+ * is NULL). Return 0 if the program can't be compiled.
+ */
+unsigned char compile_pass() {
+  program_line *line;
+  unsigned int index = 0;
+  unsigned char command;
+  char *args;
+
+  code_offset = 0;
+  for (line = program; line; line = line->next) {
+    current_line = line;
+    line_offsets[index] = code_offset;
+    emit_call(rt_line);
+    emit_word((unsigned int) line);
+    args = line->args;
+    command = line->command;
+    for (;;) {
+      compile_statement(command, args, line_offsets[index + 1]);
+      if (compile_failed) {
+        return 0;
+      }
+      args += strlen(args) + 1;
+      command = *args;
+      if (command == CMD_UNKNOWN) {
+        break;
+      }
+      ++args;
+    }
+    ++index;
+  }
+  line_offsets[index] = code_offset;
+  emit_byte(OP_JMP);
+  emit_word((unsigned int) rt_end);
+  return 1;
+}
+
+/**
+ * Compile the program. The first pass determines the code size and the line
+ * addresses, the second pass generates the code.
+ * Return the code size or 0 if an error occurred.
+ */
+unsigned int compile_program() {
+  unsigned int lines = 0;
+  unsigned int size = 0;
+  program_line *line;
+
+  compiler_free();
+  for (line = program; line; line = line->next) {
+    ++lines;
+  }
+  if (! lines) {
+    return 0;
+  }
+  line_offsets = malloc((lines + 1) * sizeof(unsigned int));
+  if (! line_offsets) {
+    syntax_error_msg("Out of memory");
+    return 0;
+  }
+  code = NULL;
+  compile_failed = 0;
+  if (compile_pass()) {
+    size = code_offset;
+    code = malloc(size);
+    current_line = NULL;
+    if (code) {
+      compile_pass();
+      compiled_code = code;
+    } else {
+      syntax_error_msg("Out of memory");
+      size = 0;
+    }
+  } else {
+    if (! error) {
+      syntax_error_msg("Cannot compile");
+    }
+  }
+  free(line_offsets);
+  current_line = NULL;
+  return size;
+}
+
+/**
+ * Run the compiled program.
+ */
+void compiled_run() {
+  compiled_execute(compiled_code);
+}
+
+/**
+ * Free the compiled program. This must be done whenever the program or the
+ * variables change.
+ */
+void compiler_free() {
+  free(compiled_code);
+  compiled_code = NULL;
+}
+
+/**
+ * Execute the interpreter command of a rt_command call.
+ * Return 1 if an error occurred.
+ */
+unsigned char __fastcall__ compiled_command(compiled_call *call) {
+  call->function(call->args);
+  return error;
+}
+
+/**
+ * Evaluate the expression 's' of a rt_eval call into compiled_acc.
+ * Return 0 if an error occurred.
+ */
+unsigned char __fastcall__ compiled_eval(char *s) {
+  compiled_acc = 0;
+  parse_number_expression(s, &compiled_acc);
+  return ! error;
+}
+
+/**
+ * Report the error 'msg' of the running compiled program.
+ */
+void __fastcall__ compiled_error(const char *msg) {
+  syntax_error_msg(msg);
+}
+
+/**
+ * Report the interruption of the running compiled program.
+ */
+void compiled_interrupted() {
+  print_interrupted();
+  lcd_cursor_blink();
+}
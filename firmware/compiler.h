@@ -0,0 +1,9 @@
+#ifndef _COMPILER_H
+#define _COMPILER_H
+
+extern unsigned char *compiled_code;
+extern unsigned int compile_program();
+extern void compiled_run();
+extern void compiler_free();
+
+#endif
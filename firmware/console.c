@@ -0,0 +1,100 @@
+#include <string.h>
+#include "acia.h"
+#include "lcd.h"
+#include "readline.h"
+#include "interrupt.h"
+#include "utils.h"
+#include "console.h"
+
+/*
+ * In console mode all output printed with lcd_putc() and lcd_puts() is sent
+ * to the serial line through the ACIA output buffer and input lines are read
+ * from the serial line. The LCD controller is not accessed, only its screen
+ * buffer is updated. It is redrawn every mirror_interval milliseconds (never
+ * if 0), so a program runs without the delays of the LCD.
+ */
+
+#define BACKSPACE 0x08
+#define DELETE    0x7f
+
+// Milliseconds between two redraws of the LCD (0 = no redraws)
+static unsigned int mirror_interval;
+
+// Time of the next redraw
+static unsigned long next_mirror;
+
+/**
+ * Switch to the serial console, the LCD is redrawn every 'interval' milliseconds.
+ */
+void console_on(unsigned int interval) {
+  mirror_interval = interval;
+  next_mirror = time_millis() + interval;
+  lcd_mode = LCD_MODE_SERIAL | LCD_MODE_DEFERRED;
+}
+
+/**
+ * Switch back to the LCD and the keyboard.
+ */
+void console_off() {
+  acia_flush();
+  lcd_mode = 0;
+  lcd_refresh();
+}
+
+/**
+ * Redraw the LCD if the mirror interval has elapsed.
+ */
+void console_update() {
+  if (mirror_interval && time_millis() >= next_mirror) {
+    next_mirror = time_millis() + mirror_interval;
+    lcd_refresh();
+  }
+}
+
+/**
+ * Read a line from the serial line into the readline buffer. The characters
+ * are echoed, those waiting in the ACIA in one block. If 'keep' is true the
+ * input is appended to the current buffer content (see readline_reedit()).
+ * If 'interruptible' is true, the input can be canceled with an NMI.
+ */
+char *console_readline(unsigned char interruptible, unsigned char keep) {
+  unsigned char length = 0;
+  int c;
+
+  if (keep) {
+    length = strlen(readline_buffer);
+  }
+  acia_flush();
+
+  for (;;) {
+    if (interruptible && is_interrupted()) {
+      break;
+    }
+    console_update();
+    c = acia_getc_nowait();
+    if (c < 0) {
+      // The echo of all characters received so far is sent at once
+      acia_flush();
+      continue;
+    }
+    if (c == '\r') {
+      continue;
+    }
+    if (c == '\n') {
+      break;
+    }
+    if (c == BACKSPACE || c == DELETE) {
+      if (length) {
+        --length;
+        acia_puts("\b \b");
+      }
+    } else if (length < READLINE_MAX_CHARS) {
+      readline_buffer[length++] = c;
+      lcd_putc(c);
+    }
+  }
+
+  readline_buffer[length] = '\0';
+  lcd_put_newline();
+  return readline_buffer;
+}
@@ -0,0 +1,13 @@
+#ifndef _CONSOLE_H
+#define _CONSOLE_H
+
+#include "lcd.h"
+
+#define console_active() (lcd_mode & LCD_MODE_SERIAL)
+
+extern void console_on(unsigned int mirror_interval);
+extern void console_off();
+extern void console_update();
+extern char *console_readline(unsigned char interruptible, unsigned char keep);
+
+#endif
@@ -0,0 +1,229 @@
+#include <string.h>
+#include <stdlib.h>
+#include "basic.h"
+#include "lexer.h"
+#include "variables.h"
+#include "data.h"
+
+/*
+ * The items of all DATA statements are parsed once into a constant pool when
+ * the first READ or RESTORE needs it. The pool is a sequence of items
+ * <DATA_INTEGER> <int> or <DATA_STRING> <chars> \0, terminated by DATA_END.
+ * An index of the DATA lines (line number and pool offset) lets RESTORE seek
+ * with a binary search. The pool is freed whenever a program line changes.
+ */
+
+#define DATA_INTEGER 0
+#define DATA_STRING 1
+#define DATA_END 0xff
+
+// A program line with DATA statements and the offset of its first item
+typedef struct _data_line {
+  unsigned int number;
+  unsigned int offset;
+} data_line;
+
+static unsigned char *constants;
+static unsigned int constants_size;
+static data_line *lines;
+static unsigned int line_count;
+
+// Next item returned by data_read()
+static unsigned char *read_ptr;
+
+/**
+ * Parse the DATA items in 'args' and append them to 'out', if 'out' is NULL
+ * they are only counted. Return the number of bytes of the items or 0xffff
+ * on a syntax error.
+ */
+static unsigned int parse_items(char *args, unsigned char *out) {
+  unsigned int size = 0;
+  unsigned char token;
+  unsigned char negative;
+  unsigned int length;
+
+  if (lex(args) == TOKEN_END) {
+    return 0;
+  }
+  for (;;) {
+    token = lex(args);
+    if (token == TOKEN_STRING && lex_ptr) {
+      length = lex_ptr - 1 - (char *) lex_value;
+      if (out) {
+        out[size] = DATA_STRING;
+        memcpy(out + size + 1, (char *) lex_value, length);
+        out[size + 1 + length] = '\0';
+      }
+      size += length + 2;
+    } else {
+      negative = token == TOKEN_MINUS;
+      if (token == TOKEN_PLUS || token == TOKEN_MINUS) {
+        token = lex(lex_ptr);
+      }
+      if (token != TOKEN_DIGITS) {
+        return 0xffff;
+      }
+      if (out) {
+        out[size] = DATA_INTEGER;
+        *((int *) (out + size + 1)) = negative ? -lex_value : lex_value;
+      }
+      size += 1 + sizeof(int);
+    }
+    args = lex_ptr;
+    token = lex(args);
+    if (token == TOKEN_END) {
+      return size;
+    } else if (token != TOKEN_COMMA) {
+      return 0xffff;
+    }
+    args = lex_ptr;
+  }
+}
+
+/**
+ * Call parse_items() for every DATA statement of 'line'.
+ * Record the line in the index if 'out' is set and it has DATA statements.
+ */
+static unsigned int parse_line(program_line *line, unsigned char *out, unsigned int offset) {
+  char *args = line->args;
+  unsigned char command = line->command;
+  unsigned int size = 0;
+  unsigned int items;
+  unsigned char found = 0;
+
+  for (;;) {
+    if (command_functions[command] == cmd_data) {
+      items = parse_items(args, out ? out + offset + size : NULL);
+      if (items == 0xffff) {
+        return items;
+      }
+      size += items;
+      found = 1;
+    }
+    args += strlen(args) + 1;
+    command = *args;
+    if (command == CMD_UNKNOWN) {
+      break;
+    }
+    ++args;
+  }
+  if (found) {
+    if (out) {
+      lines[line_count].number = line->number;
+      lines[line_count].offset = offset;
+    }
+    ++line_count;
+  }
+  return size;
+}
+
+/**
+ * Build the constant pool and the line index from the program.
+ * Return false on an error.
+ */
+static unsigned char build() {
+  program_line *line;
+  program_line *saved_line = current_line;
+  unsigned int size = 0;
+  unsigned int items;
+
+  line_count = 0;
+  for (line = program; line; line = line->next) {
+    items = parse_line(line, NULL, 0);
+    if (items == 0xffff) {
+      current_line = line;
+      syntax_error_msg("Invalid DATA");
+      current_line = saved_line;
+      return 0;
+    }
+    size += items;
+  }
+
+  constants = malloc(size + 1);
+  lines = malloc(line_count * sizeof(data_line) + 1);
+  if (! constants || ! lines) {
+    data_free();
+    syntax_error_msg("Out of memory");
+    return 0;
+  }
+
+  size = 0;
+  line_count = 0;
+  for (line = program; line; line = line->next) {
+    size += parse_line(line, constants, size);
+  }
+  constants[size] = DATA_END;
+  constants_size = size;
+  read_ptr = constants;
+  return 1;
+}
+
+/**
+ * Free the constant pool, it is rebuilt by the next READ or RESTORE.
+ * This must be done whenever a program line changes.
+ */
+void data_free() {
+  free(constants);
+  free(lines);
+  constants = NULL;
+  lines = NULL;
+}
+
+/**
+ * Continue reading with the first item of the first DATA line with a number
+ * >= 'number'. Return false on an error.
+ */
+unsigned char data_restore(unsigned int number) {
+  unsigned int low = 0;
+  unsigned int high;
+  unsigned int middle;
+
+  if (! constants && ! build()) {
+    return 0;
+  }
+  high = line_count;
+  while (low < high) {
+    middle = (low + high) >> 1;
+    if (lines[middle].number < number) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  read_ptr = constants + (low < line_count ? lines[low].offset : constants_size);
+  return 1;
+}
+
+/**
+ * Continue reading with the first item (RUN starts over).
+ */
+void data_rewind() {
+  read_ptr = constants;
+}
+
+/**
+ * Read the next item, which must be of the variable 'type', into 'value'
+ * (an int or a char * pointing into the pool). Return false on an error.
+ */
+unsigned char data_read(unsigned char type, void *value) {
+  if (! constants && ! build()) {
+    return 0;
+  }
+  if (*read_ptr == DATA_END) {
+    syntax_error_msg("Out of data");
+    return 0;
+  }
+  if (*read_ptr != (type == VAR_TYPE_STRING ? DATA_STRING : DATA_INTEGER)) {
+    syntax_error_msg("Type mismatch");
+    return 0;
+  }
+  ++read_ptr;
+  if (type == VAR_TYPE_STRING) {
+    *((char **) value) = (char *) read_ptr;
+    read_ptr += strlen((char *) read_ptr) + 1;
+  } else {
+    *((int *) value) = *((int *) read_ptr);
+    read_ptr += sizeof(int);
+  }
+  return 1;
+}
@@ -0,0 +1,9 @@
+#ifndef _DATA_H
+#define _DATA_H
+
+extern void data_free();
+extern unsigned char data_restore(unsigned int number);
+extern void data_rewind();
+extern unsigned char data_read(unsigned char type, void *value);
+
+#endif
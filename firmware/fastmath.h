@@ -0,0 +1,11 @@
+#ifndef _FASTMATH_H
+#define _FASTMATH_H
+
+extern int __fastcall__ math_mul(int a, int b);
+extern int __fastcall__ math_div(int a, int b);
+extern int __fastcall__ math_mod(int a, int b);
+extern int math_rand();
+extern void __fastcall__ math_srand(unsigned int seed);
+extern void math_seed_sid();
+
+#endif
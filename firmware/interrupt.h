@@ -7,4 +7,18 @@ extern unsigned long interrupted;
 
 #define reset_interrupted() interrupted = 0
 
+// Interrupt sources in the order of their priority (see interrupt.s65)
+#define IRQ_TIMER1 0
+#define IRQ_TIMER2 1
+#define IRQ_ACIA 2
+#define IRQ_VIA1 3
+#define IRQ_VIA2 4
+
+/**
+ * Install an assembly routine as the handler of an interrupt source and
+ * return the previous one. The routine is called with JSR and the flags of
+ * the source in A, it must clear the interrupt and preserve X and Y.
+ */
+extern void * __fastcall__ irq_set_handler(unsigned char source, void *handler);
+
 #endif
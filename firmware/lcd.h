@@ -1,6 +1,13 @@
 #ifndef _LCD_H
 #define _LCD_H
 
+// Bits of lcd_mode (keep in sync with lcd.s65)
+#define LCD_MODE_SERIAL   0x80  // Copy printed characters to the serial line
+#define LCD_MODE_DEFERRED 0x40  // Only update the screen buffer until lcd_refresh()
+
+extern unsigned char lcd_mode;
+#pragma zpsym("lcd_mode");
+
 extern void lcd_init();
 extern void __fastcall__ lcd_command(unsigned char cmd);
 extern void __fastcall__ lcd_write(char c);
@@ -16,5 +23,11 @@ extern void lcd_cursor_off();
 extern unsigned char lcd_get_x();
 extern unsigned char lcd_get_y();
 extern unsigned char __fastcall__ lcd_getc(unsigned char x, unsigned char y);
+extern void lcd_refresh();
+extern void __fastcall__ lcd_redraw(unsigned char x, unsigned char y, unsigned char w);
+extern void __fastcall__ lcd_define_char(unsigned char n, const unsigned char *bitmap);
+
+// Screen buffer, 4 rows of 40 characters (redraw changes with lcd_redraw())
+extern char lcd_display_data[];
 
 #endif
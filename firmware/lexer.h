@@ -0,0 +1,42 @@
+#ifndef _LEXER_H
+#define _LEXER_H
+
+// Language tokens (keep in sync with lexer.s65)
+#define TOKEN_INVALID       0
+#define TOKEN_END           1
+#define TOKEN_DIGITS        2
+#define TOKEN_STRING        3
+#define TOKEN_VAR_NUMBER    4
+#define TOKEN_VAR_STRING    5
+#define TOKEN_ASSIGN        6
+#define TOKEN_PLUS          7
+#define TOKEN_MINUS         8
+#define TOKEN_MUL           9
+#define TOKEN_DIV           10
+#define TOKEN_MOD           11
+#define TOKEN_COMMA         12
+#define TOKEN_EQUAL         13
+#define TOKEN_NOTEQUAL      14
+#define TOKEN_LESS          15
+#define TOKEN_LESSEQUAL     16
+#define TOKEN_GREATER       17
+#define TOKEN_GREATEREQUAL  18
+#define TOKEN_THEN          19
+#define TOKEN_ONERROR       20
+
+extern unsigned char __fastcall__ lex(const char *s);
+
+// Pointer behind the last token (NULL for an unterminated string)
+extern char *lex_ptr;
+#pragma zpsym("lex_ptr");
+
+// Value of the last token: the number of TOKEN_DIGITS, the name of
+// TOKEN_VAR_NUMBER/TOKEN_VAR_STRING or a pointer to the text of TOKEN_STRING
+extern unsigned int lex_value;
+#pragma zpsym("lex_value");
+
+// Kind of the last token
+extern unsigned char lex_token;
+#pragma zpsym("lex_token");
+
+#endif
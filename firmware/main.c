@@ -6,6 +6,7 @@
 #include "lcd.h"
 #include "basic.h"
 #include "readline.h"
+#include "console.h"
 
 int main() {
 
@@ -15,14 +16,22 @@ int main() {
   keys_init();
   basic_init();
 
+#ifdef CONSOLE
+  // Build with CONSOLE=<mirror interval> to start in console mode
+  console_on(CONSOLE);
+#endif
+
   acia_puts("6502 HomeComputer ready.\n");
-  lcd_puts("6502 HomeComputer ready!\n");
-  sprintf(print_buffer, "%u bytes free.\n", _heapmemavail());
-  lcd_puts(print_buffer);
-  lcd_puts("Ready.\n");
   lcd_cursor_on();
   lcd_cursor_blink();
 
+  if (! basic_autostart()) {
+    lcd_puts("6502 HomeComputer ready!\n");
+    sprintf(print_buffer, "%u bytes free.\n", _heapmemavail());
+    lcd_puts(print_buffer);
+    lcd_puts("Ready.\n");
+  }
+
   for (;;) {
     char * line = readline(NON_INTERRUPTIBLE);
     interpret(line);
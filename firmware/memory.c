@@ -0,0 +1,69 @@
+#include <stdlib.h>
+#include <_heap.h>
+#include "memory.h"
+
+// Linker symbols of the RAM area and the C stack size (see firmware.cfg)
+extern char _RAM_START__[];
+extern char _RAM_SIZE__[];
+extern char _STACKSIZE__[];
+
+#define C_STACK_TOP    ((unsigned char *) (_RAM_START__ + (unsigned int) _RAM_SIZE__))
+#define C_STACK_BOTTOM (C_STACK_TOP - (unsigned int) _STACKSIZE__)
+#define CPU_STACK      ((unsigned char *) 0x0100)
+
+/**
+ * Return the total number of free heap bytes (including all fragments).
+ */
+unsigned int mem_heap_free() {
+  return _heapmemavail();
+}
+
+/**
+ * Return the size of the largest block that can be allocated.
+ */
+unsigned int mem_heap_largest_block() {
+  return _heapmaxavail();
+}
+
+/**
+ * Return the number of holes in the heap free list.
+ * The untouched space at the top of the heap is not counted.
+ */
+unsigned int mem_heap_fragments() {
+  unsigned int count = 0;
+  struct freeblock *block = _heapfirst;
+  while (block) {
+    ++count;
+    block = block->next;
+  }
+  return count;
+}
+
+/**
+ * Return the high-water mark of the C stack in bytes.
+ */
+unsigned int mem_c_stack_used() {
+  unsigned char *p = C_STACK_BOTTOM;
+  while (p < C_STACK_TOP && *p == STACK_CANARY) {
+    ++p;
+  }
+  return C_STACK_TOP - p;
+}
+
+/**
+ * Return the size of the C stack in bytes.
+ */
+unsigned int mem_c_stack_size() {
+  return (unsigned int) _STACKSIZE__;
+}
+
+/**
+ * Return the high-water mark of the 6502 stack in page 1 in bytes.
+ */
+unsigned int mem_cpu_stack_used() {
+  unsigned int i = 0;
+  while (i < 256 && CPU_STACK[i] == STACK_CANARY) {
+    ++i;
+  }
+  return 256 - i;
+}
@@ -0,0 +1,20 @@
+#ifndef _MEMORY_H
+#define _MEMORY_H
+
+// Byte value startup.s65 fills the stacks with (keep in sync)
+#define STACK_CANARY 0xa5
+
+// RAM region reserved for loaded machine code (see firmware.cfg)
+extern char _USER_START__[];
+extern char _USER_SIZE__[];
+#define USER_RAM_START ((unsigned char *) _USER_START__)
+#define USER_RAM_SIZE  ((unsigned int) _USER_SIZE__)
+
+extern unsigned int mem_heap_free();
+extern unsigned int mem_heap_largest_block();
+extern unsigned int mem_heap_fragments();
+extern unsigned int mem_c_stack_used();
+extern unsigned int mem_c_stack_size();
+extern unsigned int mem_cpu_stack_used();
+
+#endif
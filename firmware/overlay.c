@@ -0,0 +1,239 @@
+#include <string.h>
+#include <stdio.h>
+#include "acia.h"
+#include "readline.h"
+#include "basic.h"
+#include "overlay.h"
+
+/*
+ * In overlay mode the program stays on the terminal host. The host splits it
+ * into blocks of consecutive lines and sends the first line number of each
+ * block when the overlay is opened. Only OVERLAY_CACHE_SLOTS blocks are kept
+ * in the program list, the least recently used one is replaced when a line
+ * of another block is needed. Blocks with the current line or a GOSUB return
+ * address are never replaced.
+ */
+
+// Marks an unused cache slot
+#define NO_BLOCK 0xff
+
+unsigned char overlay_blocks = 0;
+unsigned int overlay_hits;
+unsigned int overlay_misses;
+
+// Name of the program file on the host
+static char overlay_filename[READLINE_MAX_CHARS + 1];
+
+// First line number of each block
+static unsigned int block_first[OVERLAY_MAX_BLOCKS];
+
+// Block held by each cache slot and the time it was used last
+static unsigned char cache_block[OVERLAY_CACHE_SLOTS];
+static unsigned int cache_used[OVERLAY_CACHE_SLOTS];
+static unsigned int use_counter;
+
+/**
+ * Return the block that contains the line 'number' or NO_BLOCK.
+ */
+static unsigned char find_block(unsigned int number) {
+  unsigned char low = 0;
+  unsigned char high = overlay_blocks;
+  unsigned char middle;
+  if (number < block_first[0]) {
+    return NO_BLOCK;
+  }
+  while (high - low > 1) {
+    middle = (low + high) >> 1;
+    if (number < block_first[middle]) {
+      high = middle;
+    } else {
+      low = middle;
+    }
+  }
+  return low;
+}
+
+/**
+ * Return 1 if the line 'number' belongs to 'block'.
+ */
+static unsigned char in_block(unsigned int number, unsigned char block) {
+  return number >= block_first[block] &&
+    (block + 1 == overlay_blocks || number < block_first[block + 1]);
+}
+
+/**
+ * Request the host to send the lines 'request' of the overlay file. Each line
+ * is passed to 'handle_line'.
+ * Return 0 with an error if the file wasn't found.
+ */
+static unsigned char request_lines(const char *request, void (*handle_line)(char *)) {
+  acia_puts(request);
+  acia_puts(" \"");
+  acia_puts(overlay_filename);
+  acia_puts("\"\n");
+  for (;;) {
+    acia_puts("*NEXT\n");
+    acia_gets(readline_buffer, READLINE_MAX_CHARS);
+    if (strncmp("*EOF", readline_buffer, 4) == 0) {
+      return 1;
+    } else if (strncmp("!NOTFOUND", readline_buffer, 9) == 0) {
+      syntax_error_msg("File not found");
+      return 0;
+    }
+    handle_line(readline_buffer);
+    if (error) {
+      return 0;
+    }
+  }
+}
+
+/**
+ * Store the first line number of the next block.
+ */
+static void add_block(char *s) {
+  if (overlay_blocks == OVERLAY_MAX_BLOCKS) {
+    syntax_error_msg("Too many blocks");
+    return;
+  }
+  sscanf(s, "%u", &block_first[overlay_blocks++]);
+}
+
+/**
+ * Add a line of the requested block to the program.
+ */
+static void add_line(char *s) {
+  unsigned int number;
+  char *command = strchr(s, ' ');
+  if (command) {
+    sscanf(s, "%u", &number);
+    create_line(number, skip_whitespace(command));
+  }
+}
+
+/**
+ * Remove the lines of the block in cache slot 'slot' from the program.
+ */
+static void evict(unsigned char slot) {
+  unsigned char block = cache_block[slot];
+  unsigned int number;
+  program_line *line = program;
+  while (line) {
+    number = line->number;
+    line = line->next;
+    if (in_block(number, block)) {
+      delete_line(number);
+    }
+  }
+  cache_block[slot] = NO_BLOCK;
+}
+
+/**
+ * Return a free cache slot, the least recently used block that is not in use
+ * is evicted if necessary. Return NO_BLOCK with an error if all are in use.
+ */
+static unsigned char find_slot() {
+  unsigned char slot;
+  unsigned char victim = NO_BLOCK;
+  unsigned char block;
+  for (slot = 0; slot < OVERLAY_CACHE_SLOTS; ++slot) {
+    block = cache_block[slot];
+    if (block == NO_BLOCK) {
+      return slot;
+    }
+    if (line_in_use(block_first[block],
+        block + 1 == overlay_blocks ? 0xffff : block_first[block + 1] - 1)) {
+      continue;
+    }
+    if (victim == NO_BLOCK || cache_used[slot] < cache_used[victim]) {
+      victim = slot;
+    }
+  }
+  if (victim == NO_BLOCK) {
+    syntax_error_msg("Overlay cache full");
+  } else {
+    evict(victim);
+  }
+  return victim;
+}
+
+/**
+ * Open the program 'filename' on the host in overlay mode.
+ * Return 0 with an error if the file cannot be used as an overlay.
+ */
+unsigned char overlay_open(char *filename) {
+  unsigned char slot;
+  overlay_close();
+  strncpy(overlay_filename, filename, READLINE_MAX_CHARS);
+  overlay_hits = 0;
+  overlay_misses = 0;
+  use_counter = 0;
+  for (slot = 0; slot < OVERLAY_CACHE_SLOTS; ++slot) {
+    cache_block[slot] = NO_BLOCK;
+  }
+  if (! request_lines("*OVERLAY", add_block) || overlay_blocks == 0) {
+    if (! error) {
+      syntax_error_msg("Program is empty");
+    }
+    overlay_blocks = 0;
+    return 0;
+  }
+  return 1;
+}
+
+/**
+ * Leave overlay mode, the cached lines stay in the program.
+ */
+void overlay_close() {
+  overlay_blocks = 0;
+}
+
+/**
+ * Make sure the block containing the line 'number' is in memory.
+ * Return 0 with an error if the block could not be fetched.
+ */
+unsigned char overlay_load(unsigned int number) {
+  unsigned char block = find_block(number);
+  unsigned char slot;
+  if (block == NO_BLOCK) {
+    return 1;
+  }
+  ++use_counter;
+  for (slot = 0; slot < OVERLAY_CACHE_SLOTS; ++slot) {
+    if (cache_block[slot] == block) {
+      ++overlay_hits;
+      cache_used[slot] = use_counter;
+      return 1;
+    }
+  }
+  ++overlay_misses;
+  if ((slot = find_slot()) == NO_BLOCK) {
+    return 0;
+  }
+  sprintf(print_buffer, "*BLOCK %u", block);
+  if (! request_lines(print_buffer, add_line)) {
+    return 0;
+  }
+  cache_block[slot] = block;
+  cache_used[slot] = use_counter;
+  return 1;
+}
+
+/**
+ * Return the first line of the overlay program.
+ */
+program_line *overlay_first_line() {
+  return find_line(block_first[0]);
+}
+
+/**
+ * Return the line that follows 'line' in the overlay program, fetching the
+ * next block if 'line' is the last line of its block.
+ */
+program_line *overlay_next_line(program_line *line) {
+  unsigned char block = find_block(line->number);
+  if (block + 1 < overlay_blocks &&
+      (! line->next || line->next->number >= block_first[block + 1])) {
+    return find_line(block_first[block + 1]);
+  }
+  return line->next;
+}
@@ -0,0 +1,25 @@
+#ifndef _OVERLAY_H
+#define _OVERLAY_H
+
+#include "basic.h"
+
+// Maximum number of blocks of an overlay program
+#define OVERLAY_MAX_BLOCKS 128
+
+// Number of blocks kept in memory
+#define OVERLAY_CACHE_SLOTS 4
+
+// Number of blocks of the open overlay program (0 if overlay mode is off)
+extern unsigned char overlay_blocks;
+
+// Block lookups that found the block in memory / had to fetch it
+extern unsigned int overlay_hits;
+extern unsigned int overlay_misses;
+
+extern unsigned char overlay_open(char *filename);
+extern void overlay_close();
+extern unsigned char overlay_load(unsigned int number);
+extern program_line *overlay_first_line();
+extern program_line *overlay_next_line(program_line *line);
+
+#endif
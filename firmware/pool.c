@@ -0,0 +1,68 @@
+#include <stdlib.h>
+#include "pool.h"
+
+/**
+ * Allocate a new slab of POOL_SLAB_OBJECTS objects and put them onto the
+ * free list of the pool 'p'.
+ * Return 0 if there isn't enough heap memory left.
+ */
+static unsigned char pool_grow(pool *p) {
+  unsigned char i;
+  char *object;
+  pool_slab *slab = malloc(sizeof(pool_slab) + POOL_SLAB_OBJECTS * p->object_size);
+  if (! slab) {
+    return 0;
+  }
+  slab->next = p->slabs;
+  p->slabs = slab;
+  object = (char *) (slab + 1);
+  for (i = 0; i < POOL_SLAB_OBJECTS; ++i) {
+    *((void **) object) = p->free_list;
+    p->free_list = object;
+    object += p->object_size;
+  }
+  p->capacity += POOL_SLAB_OBJECTS;
+  return 1;
+}
+
+/**
+ * Take an object from the pool 'p'.
+ * Return NULL if there isn't enough memory left.
+ */
+void * pool_alloc(pool *p) {
+  void *object = p->free_list;
+  if (! object) {
+    if (! pool_grow(p)) {
+      return NULL;
+    }
+    object = p->free_list;
+  }
+  p->free_list = *((void **) object);
+  ++p->used;
+  return object;
+}
+
+/**
+ * Return the object 'object' to the pool 'p'.
+ */
+void pool_free(pool *p, void *object) {
+  *((void **) object) = p->free_list;
+  p->free_list = object;
+  --p->used;
+}
+
+/**
+ * Release all objects of the pool 'p' and return its slabs to the heap.
+ */
+void pool_free_all(pool *p) {
+  pool_slab *slab = p->slabs;
+  while (slab) {
+    pool_slab *next = slab->next;
+    free(slab);
+    slab = next;
+  }
+  p->slabs = NULL;
+  p->free_list = NULL;
+  p->used = 0;
+  p->capacity = 0;
+}
@@ -0,0 +1,27 @@
+#ifndef _POOL_H
+#define _POOL_H
+
+// Number of objects allocated at once when a pool runs empty
+#define POOL_SLAB_OBJECTS 16
+
+// A slab of objects allocated from the heap
+typedef struct _pool_slab {
+  struct _pool_slab *next;
+} pool_slab;
+
+// A pool of fixed-size objects (object_size must be >= sizeof(void *))
+typedef struct _pool {
+  unsigned char object_size;
+  void *free_list;
+  pool_slab *slabs;
+  unsigned int used;
+  unsigned int capacity;
+} pool;
+
+#define POOL_INITIALIZER(type) { sizeof(type), NULL, NULL, 0, 0 }
+
+extern void * pool_alloc(pool *p);
+extern void pool_free(pool *p, void *object);
+extern void pool_free_all(pool *p);
+
+#endif
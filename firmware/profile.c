@@ -0,0 +1,51 @@
+#ifdef PROFILE
+
+#include <stdio.h>
+#include <string.h>
+#include "profile.h"
+#include "acia.h"
+
+// Counters of the profiling slots (see profile.s65)
+extern unsigned long profile_cycles[PROFILE_SLOTS];
+extern unsigned long profile_millis[PROFILE_SLOTS];
+extern unsigned int profile_calls[PROFILE_SLOTS];
+
+// Longest measured interrupt latency of the timer tick (see interrupt.s65)
+extern unsigned int irq_latency;
+
+// Names of the profiling slots
+const char *profile_names[PROFILE_SLOTS] = {
+  "lcd_putc", "acia_puts", "keys_update", "find_variable", "interpret"
+};
+
+/**
+ * Send the calls, the total cycles and the average cycles per call of each
+ * profiling slot and the longest interrupt latency over the serial line. One
+ * cycle is one microsecond at 1 MHz.
+ */
+void profile_dump() {
+  static char line[60];
+  unsigned char slot;
+  unsigned long cycles;
+  acia_puts("Routine           Calls        Cycles      Avg\n");
+  for (slot = 0; slot < PROFILE_SLOTS; ++slot) {
+    cycles = profile_cycles[slot] + profile_millis[slot] * 1000;
+    sprintf(line, "%-14s %8u %13lu %8lu\n", profile_names[slot], profile_calls[slot],
+      cycles, profile_calls[slot] ? cycles / profile_calls[slot] : 0);
+    acia_puts(line);
+  }
+  sprintf(line, "IRQ latency    %8u cycles (max)\n", irq_latency);
+  acia_puts(line);
+}
+
+/**
+ * Reset the counters of all profiling slots.
+ */
+void profile_clear() {
+  memset(profile_cycles, 0, sizeof(profile_cycles));
+  memset(profile_millis, 0, sizeof(profile_millis));
+  memset(profile_calls, 0, sizeof(profile_calls));
+  irq_latency = 0;
+}
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef _PROFILE_H
+#define _PROFILE_H
+
+// Profiling slots (keep in sync with profile.inc65)
+#define PROFILE_LCD_PUTC 0
+#define PROFILE_ACIA_PUTS 1
+#define PROFILE_KEYS_UPDATE 2
+#define PROFILE_FIND_VARIABLE 3
+#define PROFILE_INTERPRET 4
+#define PROFILE_SLOTS 5
+
+#ifdef PROFILE
+
+extern void __fastcall__ profile_enter(unsigned char slot);
+extern void __fastcall__ profile_exit(unsigned char slot);
+extern void profile_dump();
+extern void profile_clear();
+
+#define PROFILE_ENTER(slot) profile_enter(slot)
+#define PROFILE_EXIT(slot) profile_exit(slot)
+
+#else
+
+#define PROFILE_ENTER(slot)
+#define PROFILE_EXIT(slot)
+
+#endif
+
+#endif
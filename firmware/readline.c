@@ -4,7 +4,11 @@
 #include "readline.h"
 #include "interrupt.h"
 #include "debug.h"
+#include "console.h"
+#include "replay.h"
+#include "basic.h"
 
+char * edit_line(unsigned char interruptible);
 void insert_character(char c);
 void delete_prev_character();
 void delete_character();
@@ -13,9 +17,12 @@ void cursor_left();
 void cursor_right();
 void cursor_start();
 void cursor_end();
+unsigned char cursor_offset();
+void sync_line_start(char *pos);
+void goto_pos(char *pos);
+void repaint(char *from, unsigned char blanks, char *cursor);
 
-// Maximum number of characters in the input buffer
-#define MAX_CHARS 79
+#define MAX_CHARS READLINE_MAX_CHARS
 
 // Input buffer
 char readline_buffer[MAX_CHARS + 1];
@@ -29,23 +36,50 @@ char *buffer_pos;
 // If true the next call to readline() re-displays the input buffer
 unsigned char reedit = 0;
 
+// Screen offset (row * 40 + column) of the first character of the input buffer
+unsigned char line_start;
+
 /**
  * Lets the user edit an input line with MAX_CHARS characters.
  * A Pointer to the input line buffer is returned from readline().
  * If interruptible is true, the input can be canceled with an NMI.
+ * While an input recording is replayed, the line is taken from the recording.
  */
 char * readline(unsigned char interruptible) {
+  if (replay_mode) {
+    if (replay_readline(readline_buffer)) {
+      reedit = 0;
+      return readline_buffer;
+    }
+    edit_line(interruptible);
+    replay_record_line(readline_buffer);
+    return readline_buffer;
+  }
+  return edit_line(interruptible);
+}
+
+/**
+ * Read the input line from the keyboard or the console.
+ */
+char * edit_line(unsigned char interruptible) {
   unsigned char last_key = KEY_NONE;
   char last_char;
   unsigned char last_modifiers;
   reset_interrupted();
 
+  if (console_active()) {
+    unsigned char keep = reedit;
+    reedit = 0;
+    return console_readline(interruptible, keep);
+  }
+
   if (reedit) {
     reedit = 0;
   } else {
     *readline_buffer = '\0';
     buffer_pos = readline_buffer;
     buffer_end = readline_buffer;
+    sync_line_start(readline_buffer);
   }
 
   for (;;) {
@@ -87,6 +121,9 @@ char * readline(unsigned char interruptible) {
       }
     } else {
       last_key = KEY_NONE;
+      if (background_tasks && running) {
+        run_idle_task();
+      }
     }
   }
 
@@ -94,119 +131,120 @@ char * readline(unsigned char interruptible) {
 }
 
 /**
- * Insert the character c at the current cursor position.
- * Move all following characters to the right.
+ * Return the current LCD cursor position as screen offset (row * 40 + column).
  */
-void insert_character(char c) {
-  if (buffer_end - readline_buffer < MAX_CHARS) {
-    if (buffer_pos < buffer_end) {
-      unsigned x = lcd_get_x();
-      unsigned y = lcd_get_y();
-      char *pos = buffer_pos;
-      while (pos <= buffer_end) {
-        char old_c = *pos;
-        lcd_putc(c);
-        *pos = c;
-        c = old_c;
-        ++pos;
-      }
-      if (buffer_end - readline_buffer >= 39) {
-        if (buffer_end - readline_buffer == 39) {
-          lcd_goto(x + 1, y - 1);
-        } else {
-          if (x == 39) {
-            lcd_goto(0, y +1);
-          } else {
-            lcd_goto(x + 1, y);
-          }
-        }
-      } else {
-        lcd_goto(x + 1, y);
-      }
-    } else {
-      lcd_putc(c);
-      *buffer_pos = c;
-    }
-    ++buffer_pos;
-    ++buffer_end;
-    *buffer_end = '\0';
+unsigned char cursor_offset() {
+  unsigned char y = lcd_get_y();
+  return (y << 5) + (y << 3) + lcd_get_x();
+}
+
+/**
+ * The LCD cursor shows the buffer position 'pos'. Recalculate the screen
+ * offset of the buffer start (the screen may have scrolled while printing).
+ */
+void sync_line_start(char *pos) {
+  line_start = cursor_offset() - (pos - readline_buffer);
+}
+
+/**
+ * Move the LCD cursor to the screen position of the buffer position 'pos'.
+ * This is the only place where buffer positions are mapped to rows and columns.
+ */
+void goto_pos(char *pos) {
+  unsigned char offset = line_start + (pos - readline_buffer);
+  unsigned char y = 0;
+  while (offset >= 40) {
+    offset -= 40;
+    ++y;
   }
+  lcd_goto(offset, y);
 }
 
 /**
- * Delete the character at the cursor position.
- * Move all following  characters to the left.
+ * Print the buffer from 'from' to its end followed by 'blanks' spaces and
+ * move the cursor to 'cursor' afterwards. The LCD cursor must be at 'from'.
+ * The last space is written without advancing the cursor, so clearing the
+ * last screen cell doesn't scroll the display.
  */
-void delete_prev_character() {
-  if (buffer_pos > readline_buffer) {
-    if (buffer_pos == buffer_end) {
-      --buffer_pos;
-      --buffer_end;
-      *buffer_pos = '\0';
-      if (lcd_get_x() == 0) {
-        lcd_goto(39, lcd_get_y() - 1);
-        lcd_putc(' ');
-        lcd_goto(39, lcd_get_y() - 1);
-      } else {
-        lcd_goto(lcd_get_x() - 1, lcd_get_y());
-        lcd_putc(' ');
-        lcd_goto(lcd_get_x() - 1, lcd_get_y());
-      }
-    } else {
-      char * pos;
-      unsigned x = lcd_get_x();
-      unsigned y = lcd_get_y();
-      if (x == 0) {
-        x = 39; y -= 1;
-      } else {
-        x -= 1;
-      }
-      lcd_goto(x, y);
-      pos = buffer_pos;
-      while (pos < buffer_end) {
-        lcd_putc(*pos);
-        *(pos - 1) = *pos;
-        ++pos;
-      }
+void repaint(char *from, unsigned char blanks, char *cursor) {
+  char *pos = from;
+  while (pos < buffer_end) {
+    lcd_putc(*pos);
+    ++pos;
+  }
+  if (blanks) {
+    while (--blanks) {
       lcd_putc(' ');
-      --buffer_pos;
-      --buffer_end;
-      *buffer_end = '\0';
-      lcd_goto(x, y);
+      ++pos;
     }
+    sync_line_start(pos);
+    lcd_write(' ');
+  } else {
+    sync_line_start(pos);
+  }
+  if (cursor != pos) {
+    goto_pos(cursor);
+  }
+}
+
+/**
+ * Insert the character c at the current cursor position.
+ * Move all following characters to the right and repaint them once.
+ */
+void insert_character(char c) {
+  char *from = buffer_pos;
+  if (buffer_end - readline_buffer == MAX_CHARS) {
+    return;
+  }
+  memmove(buffer_pos + 1, buffer_pos, buffer_end - buffer_pos + 1);
+  *buffer_pos++ = c;
+  ++buffer_end;
+  if (buffer_pos == buffer_end) {
+    lcd_putc(c);
+    sync_line_start(buffer_end);
+  } else {
+    repaint(from, 0, buffer_pos);
   }
 }
 
 /**
  * Delete the character left to the cursor.
- * Move the character at the cursor and all following  characters
+ * Move the character at the cursor and all following characters
  * to the left.
  */
+void delete_prev_character() {
+  if (buffer_pos > readline_buffer) {
+    --buffer_pos;
+    memmove(buffer_pos, buffer_pos + 1, buffer_end - buffer_pos);
+    --buffer_end;
+    goto_pos(buffer_pos);
+    repaint(buffer_pos, 1, buffer_pos);
+  }
+}
+
+/**
+ * Delete the character at the cursor position.
+ * Move all following characters to the left.
+ */
 void delete_character() {
   if (buffer_pos < buffer_end) {
-    char *pos;
-    unsigned x = lcd_get_x();
-    unsigned y = lcd_get_y();
-    pos = buffer_pos + 1;
-    while (*pos) {
-      char c = *(pos);
-      lcd_putc(c);
-      *(pos - 1) = c;
-      ++pos;
-    }
-    lcd_putc(' ');
+    memmove(buffer_pos, buffer_pos + 1, buffer_end - buffer_pos);
     --buffer_end;
-    *buffer_end = '\0';
-    lcd_goto(x, y);
+    repaint(buffer_pos, 1, buffer_pos);
   }
 }
 
 /**
- * Clear the input buffer.
+ * Delete all characters left to the cursor.
  */
 void delete_all_characters() {
-  while (buffer_pos != readline_buffer) {
-    delete_prev_character();
+  unsigned char n = buffer_pos - readline_buffer;
+  if (n > 0) {
+    memmove(readline_buffer, buffer_pos, buffer_end - buffer_pos + 1);
+    buffer_pos = readline_buffer;
+    buffer_end -= n;
+    goto_pos(readline_buffer);
+    repaint(readline_buffer, n, readline_buffer);
   }
 }
 
@@ -216,11 +254,7 @@ void delete_all_characters() {
 void cursor_left() {
   if (buffer_pos > readline_buffer) {
     --buffer_pos;
-    if (lcd_get_x() == 0) {
-      lcd_goto(39, lcd_get_y() - 1);
-    } else {
-      lcd_goto(lcd_get_x() - 1, lcd_get_y());
-    }
+    goto_pos(buffer_pos);
   }
 }
 
@@ -230,11 +264,7 @@ void cursor_left() {
 void cursor_right() {
   if (buffer_pos < buffer_end) {
     ++buffer_pos;
-    if (lcd_get_x() == 39) {
-      lcd_goto(0, lcd_get_y() + 1);
-    } else {
-      lcd_goto(lcd_get_x() + 1, lcd_get_y());
-    }
+    goto_pos(buffer_pos);
   }
 }
 
@@ -242,8 +272,9 @@ void cursor_right() {
  * Move the cursor to the beginning of the input line.
  */
 void cursor_start() {
-  while (buffer_pos > readline_buffer) {
-    cursor_left();
+  if (buffer_pos > readline_buffer) {
+    buffer_pos = readline_buffer;
+    goto_pos(buffer_pos);
   }
 }
 
@@ -251,8 +282,9 @@ void cursor_start() {
  * Move the cursor to the end of the input line.
  */
 void cursor_end() {
-  while (buffer_pos < buffer_end) {
-    cursor_right();
+  if (buffer_pos < buffer_end) {
+    buffer_pos = buffer_end;
+    goto_pos(buffer_pos);
   }
 }
 
@@ -264,5 +296,6 @@ void readline_reedit() {
   lcd_puts(readline_buffer);
   buffer_pos = readline_buffer + strlen(readline_buffer);
   buffer_end = buffer_pos;
+  sync_line_start(buffer_end);
   reedit = 1;
 }
@@ -4,6 +4,9 @@
 #define INTERRUPTIBLE 1
 #define NON_INTERRUPTIBLE 0
 
+// Maximum number of characters in the input buffer
+#define READLINE_MAX_CHARS 79
+
 extern char * readline(unsigned char interruptible);
 extern char readline_buffer[];
 extern void readline_reedit();
@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "acia.h"
+#include "lcd.h"
+#include "basic.h"
+#include "readline.h"
+#include "replay.h"
+
+/*
+ * Input events of a running program are recorded into a file on the terminal
+ * host and can be replayed later, so a program runs with the same input and
+ * takes the same path through the interpreter every time.
+ * Events are the input lines (L <text>), integer values of rn, ti and us
+ * (V <int>) and the ti$ strings (S <text>). While recording each event is
+ * sent as "*EV <event>", the end of the recording is "*EV END". While
+ * replaying the firmware requests each event with "*EVENT", the host answers
+ * with the next recorded event or "*EOF".
+ * Events are only recorded and replayed while a program runs.
+ */
+
+unsigned char replay_mode = REPLAY_OFF;
+
+// The last event received from the host ('L ' + line)
+static char event[READLINE_MAX_CHARS + 3];
+
+/**
+ * Start recording (REPLAY_RECORD) or replaying (REPLAY_PLAY) the events file
+ * 'filename'. Return false if the file doesn't exist.
+ */
+unsigned char replay_start(unsigned char mode, char *filename) {
+  replay_stop();
+  acia_puts(mode == REPLAY_RECORD ? "*RECORD \"" : "*REPLAY \"");
+  acia_puts(filename);
+  acia_puts("\"\n");
+  if (mode == REPLAY_PLAY) {
+    acia_gets(event, sizeof(event) - 1);
+    if (strncmp("!NOTFOUND", event, 9) == 0) {
+      syntax_error_msg("File not found");
+      return 0;
+    }
+  }
+  replay_mode = mode;
+  return 1;
+}
+
+/**
+ * Stop recording or replaying.
+ */
+void replay_stop() {
+  if (replay_mode == REPLAY_RECORD) {
+    acia_puts("*EV END\n");
+  }
+  replay_mode = REPLAY_OFF;
+}
+
+/**
+ * Send the event 'type' with the value 'value' to the host.
+ */
+static void record(char type, char *value) {
+  acia_puts("*EV ");
+  acia_putc(type);
+  acia_putc(' ');
+  acia_puts(value);
+  acia_put_newline();
+}
+
+/**
+ * Return the value of the next event, which must be of type 'type'.
+ * At the end of the events or on a different event type the replay stops
+ * and NULL is returned.
+ */
+static char *next_event(char type) {
+  acia_puts("*EVENT\n");
+  acia_gets(event, sizeof(event) - 1);
+  if (event[0] == type && event[1] == ' ') {
+    return event + 2;
+  }
+  lcd_puts(strncmp("*EOF", event, 4) == 0 ? "Replay ended\n" : "Replay mismatch\n");
+  replay_mode = REPLAY_OFF;
+  return NULL;
+}
+
+/**
+ * Return the next replayed input line (copied into 'buffer') or NULL if no
+ * line is replayed.
+ */
+char *replay_readline(char *buffer) {
+  char *line;
+  if (replay_mode == REPLAY_PLAY && running && (line = next_event('L'))) {
+    strcpy(buffer, line);
+    lcd_puts(buffer);
+    lcd_put_newline();
+    return buffer;
+  }
+  return NULL;
+}
+
+/**
+ * Record the input line 'line'.
+ */
+void replay_record_line(char *line) {
+  if (replay_mode == REPLAY_RECORD && running) {
+    record('L', line);
+  }
+}
+
+/**
+ * Record 'value' or return the replayed value instead.
+ */
+int replay_value(int value) {
+  char *replayed;
+  if (running) {
+    if (replay_mode == REPLAY_RECORD) {
+      itoa(value, event, 10);
+      record('V', event);
+    } else if (replayed = next_event('V')) {
+      value = atoi(replayed);
+    }
+  }
+  return value;
+}
+
+/**
+ * Record the string 'value' or return the replayed string instead.
+ */
+char *replay_string(char *value) {
+  char *replayed;
+  if (replay_mode && running) {
+    if (replay_mode == REPLAY_RECORD) {
+      record('S', value);
+    } else if (replayed = next_event('S')) {
+      value = replayed;
+    }
+  }
+  return value;
+}
@@ -0,0 +1,20 @@
+#ifndef _REPLAY_H
+#define _REPLAY_H
+
+#define REPLAY_OFF 0
+#define REPLAY_RECORD 1
+#define REPLAY_PLAY 2
+
+extern unsigned char replay_mode;
+
+extern unsigned char replay_start(unsigned char mode, char *filename);
+extern void replay_stop();
+extern char *replay_readline(char *buffer);
+extern void replay_record_line(char *line);
+extern int replay_value(int value);
+extern char *replay_string(char *value);
+
+// Record or replay an integer the program reads from a nondeterministic source
+#define replay_int(value) (replay_mode ? replay_value(value) : (value))
+
+#endif
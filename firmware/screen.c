@@ -0,0 +1,94 @@
+#include <string.h>
+#include "lcd.h"
+#include "screen.h"
+
+/*
+ * Operations on rectangular regions of the screen. They work on the screen
+ * buffer of the LCD driver and redraw only the changed rows, each with a
+ * single cursor positioning.
+ */
+
+#define COLUMNS 40
+#define ROWS 4
+
+#define cell(x, y) (lcd_display_data + (y) * COLUMNS + (x))
+
+/**
+ * Return true if the region x,y,w,h lies within the screen. The sums x + w
+ * and y + h are not formed, they could overflow.
+ */
+unsigned char screen_region_valid(int x, int y, int w, int h) {
+  return x >= 0 && y >= 0 && w >= 0 && h >= 0 &&
+    x <= COLUMNS && w <= COLUMNS - x && y <= ROWS && h <= ROWS - y;
+}
+
+/**
+ * Fill the region x,y,w,h with the character c.
+ */
+void screen_fill(unsigned char x, unsigned char y, unsigned char w, unsigned char h, char c) {
+  if (w == 0) {
+    return;
+  }
+  while (h--) {
+    memset(cell(x, y), c, w);
+    lcd_redraw(x, y, w);
+    ++y;
+  }
+}
+
+/**
+ * Copy the region x,y,w,h to to_x,to_y (the regions may overlap).
+ */
+void screen_copy(unsigned char x, unsigned char y, unsigned char w, unsigned char h,
+                 unsigned char to_x, unsigned char to_y) {
+  if (w == 0 || h == 0) {
+    return;
+  }
+  if (to_y > y) {
+    // Copy bottom up, so overlapping rows are read before they are written
+    y += h - 1;
+    to_y += h - 1;
+    while (h--) {
+      memmove(cell(to_x, to_y), cell(x, y), w);
+      lcd_redraw(to_x, to_y, w);
+      --y;
+      --to_y;
+    }
+  } else {
+    while (h--) {
+      memmove(cell(to_x, to_y), cell(x, y), w);
+      lcd_redraw(to_x, to_y, w);
+      ++y;
+      ++to_y;
+    }
+  }
+}
+
+/**
+ * Scroll the region x,y,w,h by one character into 'direction', the freed row
+ * or column is cleared.
+ */
+void screen_scroll(unsigned char x, unsigned char y, unsigned char w, unsigned char h,
+                   unsigned char direction) {
+  if (w == 0 || h == 0) {
+    return;
+  }
+  switch (direction) {
+    case SCROLL_UP:
+      screen_copy(x, y + 1, w, h - 1, x, y);
+      screen_fill(x, y + h - 1, w, 1, ' ');
+      break;
+    case SCROLL_DOWN:
+      screen_copy(x, y, w, h - 1, x, y + 1);
+      screen_fill(x, y, w, 1, ' ');
+      break;
+    case SCROLL_LEFT:
+      screen_copy(x + 1, y, w - 1, h, x, y);
+      screen_fill(x + w - 1, y, 1, h, ' ');
+      break;
+    case SCROLL_RIGHT:
+      screen_copy(x, y, w - 1, h, x + 1, y);
+      screen_fill(x, y, 1, h, ' ');
+      break;
+  }
+}
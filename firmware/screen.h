@@ -0,0 +1,17 @@
+#ifndef _SCREEN_H
+#define _SCREEN_H
+
+// Scroll directions of screen_scroll()
+#define SCROLL_UP 0
+#define SCROLL_DOWN 1
+#define SCROLL_LEFT 2
+#define SCROLL_RIGHT 3
+
+extern unsigned char screen_region_valid(int x, int y, int w, int h);
+extern void screen_fill(unsigned char x, unsigned char y, unsigned char w, unsigned char h, char c);
+extern void screen_copy(unsigned char x, unsigned char y, unsigned char w, unsigned char h,
+                        unsigned char to_x, unsigned char to_y);
+extern void screen_scroll(unsigned char x, unsigned char y, unsigned char w, unsigned char h,
+                          unsigned char direction);
+
+#endif
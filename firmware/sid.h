@@ -2,6 +2,6 @@
 #define _SID_H
 
 extern void sid_init();
-extern void sid_synth();
+extern unsigned int sid_synth();
 
 #endif
@@ -3,6 +3,8 @@
 
 extern void __fastcall__ delay_ms(unsigned char delay);
 
+extern unsigned int time_micros();
+
 extern unsigned long millis;
 #pragma zpsym("millis");
 #define time_millis() millis
@@ -6,28 +6,55 @@
 #include "utils.h"
 #include "interrupt.h"
 #include "keys.h"
+#include "pool.h"
+#include "fastmath.h"
 #include "variables.h"
+#include "profile.h"
+#include "replay.h"
 
-// Pointer to the list of variables
+// Pointer to the list of variables of the main program and the builtins
 variable *variables = NULL;
 
+// Pointer to the list new variables are added to: the private variables of
+// the current background task (see cmd_task()) or 'variables'
+variable **scope = &variables;
+
+// Pool holding the variable nodes
+pool variable_pool = POOL_INITIALIZER(variable);
+
+// Number of watched variables (see cmd_watch()) and the last one that was changed
+unsigned char watches = 0;
+variable *watch_hit = NULL;
+
 /**
- * Find the variable with the given name.
+ * Find the variable with the given name. A background task looks at its
+ * private variables first and then at the variables of the main program.
  * Returns NULL if the variable wasn't found.
- * Returns a pointer to the previous variable in prev if prev != NULL.
+ * Returns a pointer to the previous variable of the same list in prev if
+ * prev != NULL.
  */
 variable * find_variable(unsigned int name, unsigned char type, variable **prev) {
-  variable *v = variables;
-  if (prev) {
-    *prev = NULL;
-  }
-  while (v && (v->name != name ||
-         (v->type & VAR_TYPE_MASK) != (type & VAR_TYPE_MASK))) {
+  variable **list = scope;
+  variable *v;
+  PROFILE_ENTER(PROFILE_FIND_VARIABLE);
+  for (;;) {
+    v = *list;
     if (prev) {
-      *prev = v;
+      *prev = NULL;
     }
-    v = v->next;
+    while (v && (v->name != name ||
+           (v->type & VAR_TYPE_MASK) != (type & VAR_TYPE_MASK))) {
+      if (prev) {
+        *prev = v;
+      }
+      v = v->next;
+    }
+    if (v || list == &variables) {
+      break;
+    }
+    list = &variables;
   }
+  PROFILE_EXIT(PROFILE_FIND_VARIABLE);
   return v;
 }
 
@@ -38,11 +65,17 @@ variable * find_variable(unsigned int name, unsigned char type, variable **prev)
 void create_variable(unsigned int name, unsigned char type, void *value) {
   variable *new_v;
   variable *prev_v;
+  variable **list;
   variable *v = find_variable(name, type, &prev_v);
 
-  if (v && v->type & VAR_FLAG_BUILTIN) {
-    syntax_error_msg("Cannot overwrite builtin!");
-    return;
+  // One test for both flags keeps assignments without watches fast
+  if (v && v->type & (VAR_FLAG_BUILTIN | VAR_FLAG_WATCH)) {
+    if (v->type & VAR_FLAG_BUILTIN) {
+      syntax_error_msg("Cannot overwrite builtin!");
+      return;
+    }
+    type |= VAR_FLAG_WATCH;
+    watch_hit = v;
   }
 
   if (v) {
@@ -51,10 +84,16 @@ void create_variable(unsigned int name, unsigned char type, void *value) {
     }
     new_v = v;
   } else {
-    new_v = malloc(sizeof(variable));
+    new_v = pool_alloc(&variable_pool);
+    if (! new_v) {
+      syntax_error_msg("Out of memory");
+      return;
+    }
+    // The builtins always belong to the main program
+    list = type & VAR_FLAG_BUILTIN ? &variables : scope;
     new_v->name = name;
-    new_v->next = variables;
-    variables = new_v;
+    new_v->next = *list;
+    *list = new_v;
   }
 
   new_v->type = type;
@@ -96,12 +135,17 @@ void delete_variable(unsigned int name, unsigned char type) {
     if ((v->type & VAR_TYPE_MASK) == VAR_TYPE_STRING) {
       free(v->value.string);
     }
-    if (v == variables) {
+    if (v->type & VAR_FLAG_WATCH) {
+      --watches;
+    }
+    if (v == *scope) {
+      *scope = v->next;
+    } else if (v == variables) {
       variables = v->next;
     } else {
       prev_v->next = v->next;
     }
-    free(v);
+    pool_free(&variable_pool, v);
   }
 }
 
@@ -142,21 +186,28 @@ void print_variable(variable *v, unsigned char mode) {
 char *builtin_var_time_string() {
   static char builtin_var_time_buffer[9]; // "00:00:00"
   sprintf(builtin_var_time_buffer, "%02d:%02d:%02d", time_hours(), time_minutes(), time_seconds());
-  return builtin_var_time_buffer;
+  return replay_string(builtin_var_time_buffer);
 }
 
 /**
  * Return the value of the builtin ti variable (time in milliseconds).
  */
 int builtin_var_time_integer() {
-  return time_millis();
+  return replay_int(time_millis());
+}
+
+/**
+ * Return the value of the builtin us variable (microseconds, wraps every 65 ms).
+ */
+int builtin_var_micros_integer() {
+  return replay_int(time_micros());
 }
 
 /**
  * Return the value of the builtin rn variable (random value).
  */
 int builtin_var_random_integer() {
-  return rand();
+  return replay_int(math_rand());
 }
 
 /**
@@ -165,28 +216,62 @@ int builtin_var_random_integer() {
 void init_builtin_variables() {
   create_variable(('t' << 8) | 'i', VAR_FLAG_BUILTIN | VAR_TYPE_INTEGER, builtin_var_time_integer);
   create_variable(('t' << 8) | 'i', VAR_FLAG_BUILTIN | VAR_TYPE_STRING, builtin_var_time_string);
+  create_variable(('u' << 8) | 's', VAR_FLAG_BUILTIN | VAR_TYPE_INTEGER, builtin_var_micros_integer);
   create_variable(('r' << 8) | 'n', VAR_FLAG_BUILTIN | VAR_TYPE_INTEGER, builtin_var_random_integer);
 }
 
+/**
+ * Delete the variables of the list 'list', e.g. the private variables of a
+ * task that ended.
+ */
+void free_variables(variable **list) {
+  variable *v;
+  while (v = *list) {
+    *list = v->next;
+    if ((v->type & VAR_TYPE_MASK) == VAR_TYPE_STRING) {
+      free(v->value.string);
+    }
+    pool_free(&variable_pool, v);
+  }
+}
+
 /**
  * Delete all variables except the builtin ones.
+ * The private variables of the tasks must be freed before.
  */
 void clear_variables() {
   variable *v = variables;
-  variable *delete_v;
   while (v) {
-    delete_v = v;
-    v = v->next;
-    if (delete_v->type == VAR_TYPE_STRING) {
-      free(delete_v->value.string);
+    // The value of a builtin string is a function
+    if ((v->type & (VAR_FLAG_BUILTIN | VAR_TYPE_MASK)) == VAR_TYPE_STRING) {
+      free(v->value.string);
     }
-    free(delete_v);
+    v = v->next;
   }
   variables = NULL;
+  watches = 0;
+  watch_hit = NULL;
+  pool_free_all(&variable_pool);
   init_builtin_variables();
 }
 
 
+/**
+ * Print the name and the value of the variable v ("a$ = "..."").
+ */
+void print_variable_assignment(variable *v) {
+  if (v->name > 256) {
+    lcd_putc(v->name >> 8);
+  }
+  lcd_putc(v->name & 0xff);
+  if ((v->type & VAR_TYPE_MASK) == VAR_TYPE_STRING) {
+    lcd_putc('$');
+  }
+  lcd_puts(" = ");
+  print_variable(v, VAR_PRINT_VERBOSE);
+  lcd_put_newline();
+}
+
 /**
  * List all variables.
  */
@@ -206,18 +291,7 @@ void print_all_variables() {
       } while (keys_get_code() == KEY_NONE);
     }
 
-    if (v->name > 256) {
-      lcd_putc(v->name >> 8);
-    }
-    lcd_putc(v->name & 0xff);
-    if (v->type == VAR_TYPE_STRING) {
-      lcd_putc('$');
-    }
-
-    lcd_puts(" = ");
-
-    print_variable(v, VAR_PRINT_VERBOSE);
-    lcd_put_newline();
+    print_variable_assignment(v);
 
     v = v->next;
   }
@@ -244,3 +318,27 @@ int get_integer_variable_value(variable *var) {
     return var->value.integer;
   }
 }
+
+/**
+ * Return the number of bytes used by the variables of the main program and
+ * the private ones of the current task and store the number of
+ * bytes used by the string values in 'strings_size'.
+ */
+unsigned int variables_size(unsigned int *strings_size) {
+  unsigned int size = 0;
+  variable **list = scope;
+  variable *v;
+  *strings_size = 0;
+  for (;;) {
+    for (v = *list; v; v = v->next) {
+      size += sizeof(variable);
+      if ((v->type & (VAR_FLAG_BUILTIN | VAR_TYPE_MASK)) == VAR_TYPE_STRING) {
+        *strings_size += strlen(v->value.string) + 1;
+      }
+    }
+    if (list == &variables) {
+      return size;
+    }
+    list = &variables;
+  }
+}
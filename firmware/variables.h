@@ -1,9 +1,12 @@
 #ifndef _VARIABLES_H
 #define _VARIABLES_H
 
+#include "pool.h"
+
 #define VAR_TYPE_INTEGER          0
 #define VAR_TYPE_STRING           1
 #define VAR_FLAG_BUILTIN          0x80
+#define VAR_FLAG_WATCH            0x40
 #define VAR_TYPE_MASK             0x0f
 
 #define VAR_PRINT_VALUE   0
@@ -21,14 +24,23 @@ typedef struct _variable {
   struct _variable *next;
 } variable;
 
+extern variable *variables;
+extern variable **scope;
+extern pool variable_pool;
+extern unsigned char watches;
+extern variable *watch_hit;
+
 extern void init_builtin_variables();
 extern variable * find_variable(unsigned int name, unsigned char type, variable **prev);
 extern void create_variable(unsigned int name, unsigned char type, void *value);
 extern void delete_variable(unsigned int name, unsigned char type);
 extern void print_variable(variable *v, unsigned char mode);
+extern void print_variable_assignment(variable *v);
+extern void free_variables(variable **list);
 extern void clear_variables();
 extern void print_all_variables();
 extern char * get_string_variable_value(variable *var);
 extern int get_integer_variable_value(variable *var);
+extern unsigned int variables_size(unsigned int *strings_size);
 
 #endif
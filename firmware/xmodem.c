@@ -0,0 +1,71 @@
+#include <string.h>
+#include "acia.h"
+#include "interrupt.h"
+#include "xmodem.h"
+
+#define SOH 0x01
+#define EOT 0x04
+#define ACK 0x06
+#define NAK 0x15
+
+// Request to start a transfer with CRC checksums
+#define CRC_START 'C'
+
+// Number of timeouts or bad packets in a row before the transfer is aborted
+#define MAX_RETRIES 10
+
+static unsigned char packet[XMODEM_PACKET_SIZE];
+
+/**
+ * Receive a file of 'size' bytes with the XMODEM-CRC protocol and store it at
+ * 'dest'. The padding of the last block is not stored.
+ * Return XMODEM_OK or the reason why the transfer failed.
+ */
+unsigned char xmodem_receive(unsigned char *dest, unsigned int size) {
+  unsigned char block = 1;
+  unsigned char retries = 0;
+  unsigned char response = CRC_START;
+  unsigned int count;
+  int c;
+
+  for (;;) {
+    if (is_interrupted()) {
+      acia_putc(XMODEM_CAN);
+      return XMODEM_CANCELED;
+    }
+    acia_putc(response);
+    c = acia_getc_timeout();
+    if (c == SOH) {
+      if (xmodem_read_packet(packet) &&
+          packet[0] == (unsigned char) ~packet[1] &&
+          xmodem_crc(packet + 2) == ((packet[130] << 8) | packet[131])) {
+        if (packet[0] == block) {
+          count = size < XMODEM_BLOCK_SIZE ? size : XMODEM_BLOCK_SIZE;
+          memcpy(dest, packet + 2, count);
+          dest += count;
+          size -= count;
+          ++block;
+        } else if (packet[0] != (unsigned char) (block - 1)) {
+          // Neither the expected block nor a repeated one
+          acia_putc(XMODEM_CAN);
+          return XMODEM_FAILED;
+        }
+        response = ACK;
+        retries = 0;
+        continue;
+      }
+      response = NAK;
+    } else if (c == EOT) {
+      acia_putc(ACK);
+      return size == 0 ? XMODEM_OK : XMODEM_FAILED;
+    } else if (c == XMODEM_CAN) {
+      return XMODEM_CANCELED;
+    } else if (block > 1) {
+      response = NAK;
+    }
+    if (++retries == MAX_RETRIES) {
+      acia_putc(XMODEM_CAN);
+      return XMODEM_TIMEOUT;
+    }
+  }
+}
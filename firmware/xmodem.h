@@ -0,0 +1,21 @@
+#ifndef _XMODEM_H
+#define _XMODEM_H
+
+// Block number, its complement, data block and CRC (keep in sync with xmodem.s65)
+#define XMODEM_PACKET_SIZE 132
+#define XMODEM_BLOCK_SIZE  128
+
+// Results of xmodem_receive()
+#define XMODEM_OK          0
+#define XMODEM_TIMEOUT     1
+#define XMODEM_CANCELED    2
+#define XMODEM_FAILED      3
+
+// Cancels a transfer
+#define XMODEM_CAN 0x18
+
+extern unsigned char __fastcall__ xmodem_read_packet(unsigned char *packet);
+extern unsigned int __fastcall__ xmodem_crc(const unsigned char *data);
+extern unsigned char xmodem_receive(unsigned char *dest, unsigned int size);
+
+#endif
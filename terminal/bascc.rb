@@ -0,0 +1,841 @@
+#!/bin/env ruby
+# encoding: UTF-8
+
+# Cross compile a BASIC program into a ca65 assembly module that runs without
+# the interpreter. The generated code calls the firmware drivers directly,
+# their addresses are taken from the label file of the firmware build
+# (firmware/firmware.lbl).
+#
+# Supported: let, if ... then, goto, gosub, return, end, rem, at, write, put,
+# print, input, sleep, cls, home and the builtin variables ti and rn.
+# Integer variables start with 0 instead of raising "Variable not found".
+#
+# Usage: bascc.rb <program.bas> [<firmware.lbl>] > program.s
+#        ca65 program.s
+#        ld65 -C bascc.cfg -S $6F00 -o program.bin program.o
+#
+# Copy program.bin into terminal/programs and start it on the homecomputer
+# with BLOAD "program" and SYS 28416.
+#
+# test/bascc_test.rb compares the output of the compiled programs in
+# test/bascc with the output of the interpreter.
+
+require_relative 'baspack'
+
+program_file, label_file = ARGV
+abort 'Usage: bascc.rb <program.bas> [<firmware.lbl>]' unless program_file
+label_file ||= File.expand_path('../firmware/firmware.lbl', __dir__)
+
+# Firmware entry points used by the generated code
+FIRMWARE_SYMBOLS = %w(_lcd_putc _lcd_puts _lcd_write _lcd_goto _lcd_getc _lcd_clear
+  _lcd_put_newline _readline _math_mul _math_div _math_mod _math_rand
+  _millis _interrupted pusha pushax ptr1 ptr2)
+
+# Size of a string variable (READLINE_MAX_CHARS + 1)
+STRING_SIZE = 80
+
+OPERATORS = {
+  plus: nil, minus: nil, mul: 'rt_mul', div: 'rt_div', mod: 'rt_mod',
+  equal: 'rt_equal', notequal: 'rt_notequal', less: 'rt_less',
+  lessequal: 'rt_lessequal', greater: 'rt_greater', greaterequal: 'rt_greaterequal'
+}
+
+COMPARISONS = [:equal, :notequal, :less, :lessequal, :greater, :greaterequal]
+
+class CompileError < StandardError
+end
+
+Token = Struct.new(:type, :value, :rest)
+
+# Return the first token of s (same rules as firmware/lexer.s65)
+def lex s
+  s = s.sub(/^ +/, '')
+  c = s[0]
+  case c
+  when nil, ';'
+    Token.new(:end, nil, s)
+  when /[0-9]/
+    digits = s[/^[0-9]+/]
+    Token.new(:digits, digits.to_i & 0xffff, s[digits.size..-1])
+  when '"'
+    close = s.index('"', 1)
+    raise CompileError, 'Unterminated string' unless close
+    Token.new(:string, s[1...close], s[close + 1..-1])
+  when /[a-zA-Z]/
+    if s =~ /^then/i
+      Token.new(:then, nil, s[4..-1])
+    elsif s =~ /^onerror/i
+      Token.new(:onerror, nil, s[7..-1])
+    else
+      word = s[/^[a-zA-Z][a-zA-Z0-9]*/]
+      name = word[0, 2]
+      rest = s[word.size..-1]
+      if rest[0] == '$'
+        Token.new(:var_string, name, rest[1..-1])
+      else
+        Token.new(:var_number, name, rest)
+      end
+    end
+  when '='
+    s[1] == '=' ? Token.new(:equal, nil, s[2..-1]) : Token.new(:assign, nil, s[1..-1])
+  when '<'
+    s[1] == '=' ? Token.new(:lessequal, nil, s[2..-1]) : Token.new(:less, nil, s[1..-1])
+  when '>'
+    s[1] == '=' ? Token.new(:greaterequal, nil, s[2..-1]) : Token.new(:greater, nil, s[1..-1])
+  when '!'
+    s[1] == '=' ? Token.new(:notequal, nil, s[2..-1]) : Token.new(:invalid, nil, s)
+  else
+    type = { '+' => :plus, '-' => :minus, '*' => :mul, '/' => :div, '%' => :mod, ',' => :comma }[c]
+    type ? Token.new(type, nil, s[1..-1]) : Token.new(:invalid, nil, s)
+  end
+end
+
+class Compiler
+  attr_reader :code, :int_vars, :string_vars, :strings
+
+  def initialize keywords, lines
+    @keywords = keywords
+    @lines = lines
+    @code = []
+    @int_vars = []
+    @string_vars = []
+    @strings = []
+    @label = 0
+  end
+
+  def emit *instructions
+    instructions.each { |i| @code << (' ' * 20) + i }
+  end
+
+  def label name
+    @code << "#{name}:"
+  end
+
+  def local_label
+    @label += 1
+    "@l#{@label}"
+  end
+
+  def string_constant text
+    @strings << text unless @strings.include? text
+    "str_#{@strings.index text}"
+  end
+
+  def int_var name
+    @int_vars << name unless @int_vars.include? name
+    "v_#{name}"
+  end
+
+  def string_var name
+    @string_vars << name unless @string_vars.include? name
+    "s_#{name}"
+  end
+
+  def compile
+    @lines.keys.sort.each_with_index do |number, index|
+      @line = number
+      @next_line = @lines.keys.sort[index + 1]
+      label "line_#{number}"
+      emit 'jsr line_start', ".word #{number}"
+      BasicPacker.split_statements(@lines[number]).each do |statement|
+        break if compile_statement(statement) == :rem
+      end
+    end
+    emit 'jmp program_end'
+  end
+
+  def next_line_label
+    @next_line ? "line_#{@next_line}" : 'program_end'
+  end
+
+  def line_label number
+    raise CompileError, "Line not found: #{number}" unless @lines[number]
+    "line_#{number}"
+  end
+
+  # Compile one statement, return :rem for comments (the rest of the line)
+  def compile_statement statement
+    statement = statement.lstrip
+    keyword = BasicPacker.keyword_of(@keywords, statement)
+    raise CompileError, 'Unknown command' unless keyword
+    args = statement.sub(/^[^ ]*/, '').lstrip
+    case keyword
+    when 'rem'
+      return :rem
+    when 'goto'
+      emit "jmp #{line_label args.to_i}"
+    when 'gosub'
+      emit "jsr #{line_label args.to_i}"
+    when 'return'
+      emit 'rts'
+    when 'end'
+      emit 'jmp program_end'
+    when 'cls'
+      emit 'jsr _lcd_clear'
+    when 'home'
+      emit 'lda #0', 'jsr pusha', 'lda #0', 'jsr _lcd_goto'
+    when 'let'
+      compile_let args
+    when 'if'
+      compile_if args
+    when 'put'
+      compile_put args
+    when 'print'
+      compile_put args
+      emit 'jsr _lcd_put_newline'
+    when 'at'
+      compile_at args
+    when 'write'
+      compile_string_expression args
+      emit 'jsr rt_write'
+    when 'input'
+      compile_input args
+    when 'sleep'
+      raise CompileError, 'Syntax error' unless args =~ /^[0-9]/
+      delay = args.to_i
+      raise CompileError, 'Sleep delay too long' if delay > 32767
+      emit "lda #<#{delay}", "ldx #>#{delay}", 'jsr rt_sleep'
+    else
+      raise CompileError, "Command not supported: #{keyword}"
+    end
+    nil
+  end
+
+  def expect token, type
+    raise CompileError, "Syntax error (expected #{type})" unless token.type == type
+    token.rest
+  end
+
+  # LET <variable> = <expression>
+  def compile_let args
+    variable = lex args
+    rest = expect lex(variable.rest), :assign
+    case variable.type
+    when :var_number
+      raise CompileError, 'Cannot overwrite builtin' if %w(ti rn).include? variable.value
+      compile_number_expression rest
+      target = int_var variable.value
+      emit 'lda acc', "sta #{target}", 'lda acc + 1', "sta #{target} + 1"
+    when :var_string
+      compile_string_expression rest
+      copy_string_to string_var(variable.value)
+    else
+      raise CompileError, 'Syntax error'
+    end
+  end
+
+  # IF <condition> THEN <statement>
+  def compile_if args
+    rest = compile_number_expression args
+    statement = expect lex(rest), :then
+    true_label = local_label
+    emit 'lda acc', 'ora acc + 1', "bne #{true_label}", "jmp #{next_line_label}"
+    label true_label
+    compile_statement statement
+  end
+
+  # PUT|PRINT <expression> [, <expression> ...]
+  def compile_put args
+    loop do
+      token = lex args
+      case token.type
+      when :string, :var_string
+        args = compile_string_expression args
+        emit 'jsr _lcd_puts'
+      when :digits, :plus, :minus, :var_number
+        args = compile_number_expression args
+        emit 'lda acc', 'ldx acc + 1', 'jsr print_int'
+      when :comma
+        args = token.rest
+      when :end
+        return
+      else
+        raise CompileError, 'Syntax error'
+      end
+    end
+  end
+
+  # AT <x>, <y> [, <string variable>]
+  def compile_at args
+    error_label = local_label
+    done_label = local_label
+    rest = compile_number_expression args
+    emit 'lda acc + 1', "bne #{error_label}", 'lda acc', 'cmp #40', "bcs #{error_label}", 'sta at_x'
+    rest = expect lex(rest), :comma
+    rest = compile_number_expression rest
+    emit 'lda acc + 1', "bne #{error_label}", 'lda acc', 'cmp #4', "bcs #{error_label}"
+    emit 'pha', 'lda at_x', 'jsr pusha', 'pla'
+    token = lex rest
+    if token.type == :comma
+      variable = lex token.rest
+      raise CompileError, 'Syntax error (expected string variable)' unless variable.type == :var_string
+      target = string_var variable.value
+      emit 'jsr _lcd_getc', "sta #{target}", 'lda #0', "sta #{target} + 1"
+    else
+      emit 'jsr _lcd_goto'
+    end
+    emit "jmp #{done_label}"
+    label error_label
+    emit 'lda #<msg_invalid_argument', 'ldx #>msg_invalid_argument', 'jmp runtime_error'
+    label done_label
+  end
+
+  # INPUT <variable> [ONERROR <statement>]
+  def compile_input args
+    variable = lex args
+    case variable.type
+    when :var_string
+      emit 'lda #1', 'jsr _readline'
+      copy_string_to string_var(variable.value)
+    when :var_number
+      retry_label = local_label
+      error_label = local_label
+      done_label = local_label
+      label retry_label
+      emit 'lda #1', 'jsr _readline', 'ldy _interrupted', "bne #{done_label}"
+      emit 'jsr parse_int', "bcs #{error_label}"
+      target = int_var variable.value
+      emit "sta #{target}", "stx #{target} + 1", "jmp #{done_label}"
+      label error_label
+      onerror = lex variable.rest
+      if onerror.type == :onerror
+        compile_statement onerror.rest
+      else
+        emit 'jsr input_error', "jmp #{retry_label}"
+      end
+      label done_label
+    else
+      raise CompileError, 'Invalid argument'
+    end
+  end
+
+  def copy_string_to target
+    emit "ldy #<#{target}", 'sty str_dest', "ldy #>#{target}", 'sty str_dest + 1', 'jsr str_copy'
+  end
+
+  # Load the string expression into A/X, return the rest of the text
+  def compile_string_expression s
+    token = lex s
+    case token.type
+    when :string
+      emit "lda #<#{string_constant token.value}", "ldx #>#{string_constant token.value}"
+    when :var_string
+      raise CompileError, 'Builtin not supported: ti$' if token.value == 'ti'
+      emit "lda #<#{string_var token.value}", "ldx #>#{string_var token.value}"
+    else
+      raise CompileError, 'Syntax error'
+    end
+    token.rest
+  end
+
+  # Load the number term into A/X, return the rest of the text
+  def compile_number_term s
+    token = lex s
+    case token.type
+    when :digits
+      value = token.value
+    when :plus, :minus
+      digits = lex token.rest
+      raise CompileError, 'Invalid number expression' unless digits.type == :digits
+      value = token.type == :minus ? -digits.value & 0xffff : digits.value
+      token = digits
+    when :var_number
+      case token.value
+      when 'ti'
+        emit 'php', 'sei', 'lda _millis', 'ldx _millis + 1', 'plp'
+      when 'rn'
+        emit 'jsr _math_rand'
+      else
+        name = int_var token.value
+        emit "lda #{name}", "ldx #{name} + 1"
+      end
+      return token.rest
+    else
+      raise CompileError, 'Syntax error'
+    end
+    emit "lda #<#{value}", "ldx #>#{value}"
+    token.rest
+  end
+
+  # Evaluate the expression into acc (left to right like the interpreter),
+  # return the rest of the text
+  def compile_number_expression s
+    token = lex s
+    if [:string, :var_string].include? token.type
+      s = compile_string_expression s
+      emit 'sta str_left', 'stx str_left + 1'
+      operator = lex s
+      raise CompileError, 'Invalid token' unless COMPARISONS.include? operator.type
+      s = compile_string_expression operator.rest
+      emit 'jsr str_compare', 'lda #0', 'tax', "jsr #{OPERATORS[operator.type]}"
+      return s
+    end
+    s = compile_number_term s
+    emit 'sta acc', 'stx acc + 1'
+    loop do
+      operator = lex s
+      return s unless OPERATORS.key? operator.type
+      s = compile_number_term operator.rest
+      case operator.type
+      when :plus
+        emit 'clc', 'adc acc', 'sta acc', 'txa', 'adc acc + 1', 'sta acc + 1'
+      when :minus
+        emit 'sta arg', 'stx arg + 1', 'lda acc', 'sec', 'sbc arg', 'sta acc',
+          'lda acc + 1', 'sbc arg + 1', 'sta acc + 1'
+      else
+        emit "jsr #{OPERATORS[operator.type]}"
+      end
+    end
+  end
+end
+
+# Runtime routines of the compiled program
+RUNTIME = <<'EOF'
+; Start of a line (JSR line_start .word <line number>)
+; Remember the line number for error messages and check for an interruption
+line_start:         pla
+                    sta ptr1
+                    pla
+                    sta ptr1 + 1
+                    ldy #1
+                    lda (ptr1),y
+                    sta cur_line
+                    iny
+                    lda (ptr1),y
+                    sta cur_line + 1
+                    lda _interrupted
+                    bne @interrupted
+                    lda ptr1
+                    clc
+                    adc #3
+                    sta ptr1
+                    bcc @l1
+                    inc ptr1 + 1
+@l1:                jmp (ptr1)
+@interrupted:       lda #<msg_interrupted
+                    ldx #>msg_interrupted
+                    jsr _lcd_puts
+
+; Return to the caller of the program
+program_end:        ldx saved_stack
+                    txs
+                    rts
+
+; Print "<line>: <message in A/X>!" and stop the program
+runtime_error:      sta error_msg
+                    stx error_msg + 1
+                    lda cur_line
+                    ldx cur_line + 1
+                    jsr print_uint
+                    lda #<msg_colon
+                    ldx #>msg_colon
+                    jsr _lcd_puts
+                    lda error_msg
+                    ldx error_msg + 1
+                    jsr _lcd_puts
+                    lda #<msg_error_end
+                    ldx #>msg_error_end
+                    jsr _lcd_puts
+                    jmp program_end
+
+; Report an invalid number input
+input_error:        lda cur_line
+                    ldx cur_line + 1
+                    jsr print_uint
+                    lda #<msg_colon
+                    ldx #>msg_colon
+                    jsr _lcd_puts
+                    lda #<msg_invalid_number
+                    ldx #>msg_invalid_number
+                    jsr _lcd_puts
+                    lda #<msg_error_end
+                    ldx #>msg_error_end
+                    jsr _lcd_puts
+                    lda #<msg_enter_again
+                    ldx #>msg_enter_again
+                    jmp _lcd_puts
+
+; Print the signed number in A/X
+print_int:          cpx #$80
+                    bcc print_uint
+                    pha
+                    lda #'-'
+                    jsr _lcd_putc
+                    pla
+                    eor #$ff
+                    clc
+                    adc #1
+                    pha
+                    txa
+                    eor #$ff
+                    adc #0
+                    tax
+                    pla
+
+; Print the unsigned number in A/X
+print_uint:         sta num
+                    stx num + 1
+                    ldy #0
+@divide:            lda #0
+                    ldx #16
+@bit:               asl num
+                    rol num + 1
+                    rol a
+                    cmp #10
+                    bcc @next
+                    sbc #10
+                    inc num
+@next:              dex
+                    bne @bit
+                    pha
+                    iny
+                    lda num
+                    ora num + 1
+                    bne @divide
+@print:             pla
+                    ora #'0'
+                    jsr _lcd_putc
+                    dey
+                    bne @print
+                    rts
+
+; Parse the integer [+-]<digits> in the string A/X
+; @out A/X The value
+; @out C Set if the string doesn't start with a number
+parse_int:          sta ptr1
+                    stx ptr1 + 1
+                    ldy #0
+                    sty num
+                    sty num + 1
+                    sty negative
+                    jsr skip_spaces
+                    cmp #'+'
+                    beq @sign
+                    cmp #'-'
+                    bne @first
+                    dec negative
+@sign:              iny
+                    jsr skip_spaces
+@first:             sec
+                    sbc #'0'
+                    cmp #10
+                    bcs @done
+@digit:             sta digit
+                    asl num
+                    rol num + 1
+                    lda num
+                    ldx num + 1
+                    asl num
+                    rol num + 1
+                    asl num
+                    rol num + 1
+                    clc
+                    adc num
+                    sta num
+                    txa
+                    adc num + 1
+                    sta num + 1
+                    lda num
+                    clc
+                    adc digit
+                    sta num
+                    bcc @l1
+                    inc num + 1
+@l1:                iny
+                    lda (ptr1),y
+                    sec
+                    sbc #'0'
+                    cmp #10
+                    bcc @digit
+                    bit negative
+                    bpl @positive
+                    lda #0
+                    sec
+                    sbc num
+                    sta num
+                    lda #0
+                    sbc num + 1
+                    sta num + 1
+@positive:          lda num
+                    ldx num + 1
+                    clc
+@done:              rts
+
+; Skip spaces at (ptr1),y and return the next character in A
+skip_spaces:        lda (ptr1),y
+                    cmp #' '
+                    bne @done
+                    iny
+                    bne skip_spaces
+@done:              rts
+
+; Copy the string A/X to the string variable at str_dest
+str_copy:           sta ptr1
+                    stx ptr1 + 1
+                    lda str_dest
+                    sta ptr2
+                    lda str_dest + 1
+                    sta ptr2 + 1
+                    ldy #0
+@next:              lda (ptr1),y
+                    sta (ptr2),y
+                    beq @done
+                    iny
+                    cpy #(STRING_SIZE - 1)
+                    bne @next
+                    lda #0
+                    sta (ptr2),y
+@done:              rts
+
+; Compare the string str_left with the string A/X
+; @out acc -1, 0 or 1 like strcmp()
+str_compare:        sta ptr2
+                    stx ptr2 + 1
+                    lda str_left
+                    sta ptr1
+                    lda str_left + 1
+                    sta ptr1 + 1
+                    ldy #0
+@next:              lda (ptr1),y
+                    cmp (ptr2),y
+                    bne @different
+                    cmp #0
+                    beq @equal
+                    iny
+                    bne @next
+@equal:             lda #0
+                    sta acc
+                    sta acc + 1
+                    rts
+@different:         bcc @less
+                    lda #1
+                    sta acc
+                    lda #0
+                    sta acc + 1
+                    rts
+@less:              lda #$ff
+                    sta acc
+                    sta acc + 1
+                    rts
+
+; Print the first character of the string A/X at the cursor position
+rt_write:           sta ptr1
+                    stx ptr1 + 1
+                    ldy #0
+                    lda (ptr1),y
+                    beq @empty
+                    jmp _lcd_write
+@empty:             lda #<msg_invalid_argument
+                    ldx #>msg_invalid_argument
+                    jmp runtime_error
+
+; Wait for A/X milliseconds (up to 32767) or an interruption
+rt_sleep:           php
+                    sei
+                    clc
+                    adc _millis
+                    sta sleep_end
+                    txa
+                    adc _millis + 1
+                    sta sleep_end + 1
+                    plp
+@wait:              lda _interrupted
+                    bne @done
+                    php
+                    sei
+                    lda _millis
+                    ldx _millis + 1
+                    plp
+                    sec
+                    sbc sleep_end
+                    txa
+                    sbc sleep_end + 1
+                    bmi @wait
+@done:              rts
+
+; acc = acc * A/X
+rt_mul:             jsr push_acc
+                    jsr _math_mul
+                    jmp store_acc
+
+; acc = acc / A/X
+rt_div:             jsr check_divisor
+                    jsr push_acc
+                    jsr _math_div
+                    jmp store_acc
+
+; acc = acc % A/X
+rt_mod:             jsr check_divisor
+                    jsr push_acc
+                    jsr _math_mod
+                    jmp store_acc
+
+check_divisor:      sta arg
+                    stx arg + 1
+                    ora arg + 1
+                    beq @zero
+                    lda arg
+                    rts
+@zero:              lda #<msg_division_by_zero
+                    ldx #>msg_division_by_zero
+                    jmp runtime_error
+
+; Push acc onto the C stack, leave A/X unchanged
+push_acc:           sta arg
+                    stx arg + 1
+                    lda acc
+                    ldx acc + 1
+                    jsr pushax
+                    lda arg
+                    ldx arg + 1
+                    rts
+
+store_acc:          sta acc
+                    stx acc + 1
+                    rts
+
+; acc = acc <comparison> A/X
+rt_equal:           jsr is_equal
+                    jmp set_bool
+rt_notequal:        jsr is_equal
+                    jmp set_not_bool
+rt_less:            jsr acc_less_arg
+                    jmp set_bool
+rt_greaterequal:    jsr acc_less_arg
+                    jmp set_not_bool
+rt_greater:         jsr arg_less_acc
+                    jmp set_bool
+rt_lessequal:       jsr arg_less_acc
+                    jmp set_not_bool
+
+; @out C Set if acc == A/X
+is_equal:           sta arg
+                    stx arg + 1
+                    lda acc
+                    cmp arg
+                    bne @not_equal
+                    lda acc + 1
+                    cmp arg + 1
+                    bne @not_equal
+                    sec
+                    rts
+@not_equal:         clc
+                    rts
+
+; @out C Set if acc < A/X (signed)
+acc_less_arg:       sta arg
+                    stx arg + 1
+                    lda acc
+                    cmp arg
+                    lda acc + 1
+                    sbc arg + 1
+                    bvc @l1
+                    eor #$80
+@l1:                asl
+                    rts
+
+; @out C Set if A/X < acc (signed)
+arg_less_acc:       sta arg
+                    stx arg + 1
+                    cmp acc
+                    txa
+                    sbc acc + 1
+                    bvc @l1
+                    eor #$80
+@l1:                asl
+                    rts
+
+; acc = C
+set_bool:           lda #0
+                    sta acc + 1
+                    rol
+                    sta acc
+                    rts
+
+; acc = ! C
+set_not_bool:       lda #0
+                    sta acc + 1
+                    rol
+                    eor #1
+                    sta acc
+                    rts
+EOF
+
+keywords = BasicPacker.keywords
+
+# Read the firmware symbols
+abort "#{label_file} not found, build the firmware first" unless File.exist? label_file
+symbols = {}
+File.readlines(label_file).each do |line|
+  symbols[$2] = $1.to_i(16) if line =~ /^al ([0-9A-Fa-f]+) \.(\w+)/
+end
+FIRMWARE_SYMBOLS.each do |symbol|
+  abort "#{label_file}: Symbol #{symbol} not found" unless symbols[symbol]
+end
+
+lines = {}
+File.readlines(program_file).each_with_index do |line, index|
+  line = line.chomp
+  next if line.strip.empty?
+  abort "#{program_file}:#{index + 1}: Missing line number" unless line =~ /^(\d+) +(.*)$/
+  lines[$1.to_i] = $2
+end
+
+compiler = Compiler.new keywords, lines
+begin
+  compiler.compile
+rescue CompileError => e
+  line = compiler.instance_variable_get :@line
+  abort "#{program_file}: line #{line}: #{e.message}"
+end
+
+puts "; Generated by bascc.rb from #{File.basename program_file}, do not edit"
+puts
+puts "STRING_SIZE = #{STRING_SIZE}"
+puts
+FIRMWARE_SYMBOLS.each do |symbol|
+  puts "#{symbol.ljust 20}= $#{sprintf '%04X', symbols[symbol]}"
+end
+puts
+puts '                    .code'
+puts
+puts '; Entry point at the load address'
+puts 'start:              tsx'
+puts '                    stx saved_stack'
+puts compiler.code
+puts
+puts RUNTIME
+puts '                    .rodata'
+puts
+compiler.strings.each_with_index do |text, index|
+  puts "str_#{index}:".ljust(20) + ".byte \"#{text}\", 0"
+end
+puts 'msg_interrupted:    .byte "Interrupted.", $0a, 0'
+puts 'msg_colon:          .byte ": ", 0'
+puts 'msg_error_end:      .byte "!", $0a, 0'
+puts 'msg_invalid_argument: .byte "Invalid argument", 0'
+puts 'msg_invalid_number: .byte "Invalid number expression", 0'
+puts 'msg_enter_again:    .byte "Enter again: ", 0'
+puts 'msg_division_by_zero: .byte "Division by zero", 0'
+puts
+puts '                    .data'
+puts
+puts '; Variables (part of the binary, so they start with 0)'
+compiler.int_vars.each do |name|
+  puts "v_#{name}:".ljust(20) + '.word 0'
+end
+compiler.string_vars.each do |name|
+  puts "s_#{name}:".ljust(20) + '.res STRING_SIZE, 0'
+end
+puts 'acc:                .word 0'
+puts 'arg:                .word 0'
+puts 'num:                .word 0'
+puts 'cur_line:           .word 0'
+puts 'error_msg:          .word 0'
+puts 'str_left:           .word 0'
+puts 'str_dest:           .word 0'
+puts 'sleep_end:          .word 0'
+puts 'saved_stack:        .byte 0'
+puts 'negative:           .byte 0'
+puts 'digit:              .byte 0'
+puts 'at_x:               .byte 0'
@@ -0,0 +1,123 @@
+#!/bin/env ruby
+# encoding: UTF-8
+
+# Compression of program lines on the serial line (see expand_line() in
+# firmware/basic.c): a line starts with TRANSFER_TOKEN + the difference to the
+# previous line number (1..127) or with TRANSFER_TOKEN <number> ' ', keywords
+# at the start of a statement are replaced by TRANSFER_TOKEN + their index in
+# the keyword table. Lines that start with a digit are not compressed.
+#
+# terminal.rb compresses every program loaded with LOAD (start it with
+# --no-compress to send plain lines) and expands the lines of SAVE.
+#
+# Usage: bascompress.rb <program.bas> ... prints the compression ratio and the
+# estimated transfer times of the programs
+
+require_relative 'baspack'
+
+TRANSFER_TOKEN = 0x80
+
+# Bytes per second at 9600 baud (8N1)
+SERIAL_BYTES_PER_SECOND = 960
+
+# Bytes of the *NEXT request the firmware sends for every line
+LINE_REQUEST_BYTES = 6
+
+class LineCompressor
+  def initialize keywords
+    @keywords = keywords
+    @previous = 0
+  end
+
+  # Compress the program line 'line' ("<number> <statements>")
+  def compress line
+    line = line.chomp
+    unless line.ascii_only? && line =~ /^(\d+) +(.*)$/
+      # The firmware takes the number of a plain line as well (see expand_line())
+      @previous = line.to_i
+      return line
+    end
+    number, text = $1.to_i, $2
+    delta = number - @previous
+    @previous = number
+    head = delta > 0 && delta < 0x80 ? (TRANSFER_TOKEN + delta).chr : "#{TRANSFER_TOKEN.chr}#{number} "
+    head.b + compress_statements(text)
+  end
+
+  # Expand the received line 'line' into a program line
+  def expand line
+    line = line.b.chomp
+    first = line.getbyte(0)
+    if first.nil? || first < TRANSFER_TOKEN
+      @previous = line.to_i
+      return line
+    end
+    if first == TRANSFER_TOKEN
+      @previous = line[1..-1].to_i
+      body = line[1..-1].sub(/^\d+ */n, '')
+    else
+      @previous += first - TRANSFER_TOKEN
+      body = line[1..-1]
+    end
+    text = "#{@previous} "
+    body.each_byte.with_index do |byte, index|
+      if byte >= TRANSFER_TOKEN
+        text << @keywords[byte - TRANSFER_TOKEN]
+        text << ' ' unless [nil, ':'.ord].include? body.getbyte(index + 1)
+      else
+        text << byte.chr
+      end
+    end
+    text
+  end
+
+  # Compression report of the program file 'filename'
+  def self.report keywords, filename
+    lines = File.readlines(filename).map(&:chomp).reject { |line| line.strip.empty? }
+    compressor = LineCompressor.new(keywords)
+    compressed = lines.map { |line| compressor.compress line }
+    plain_bytes = lines.map { |line| line.bytesize + 1 }.inject(0, :+)
+    compressed_bytes = compressed.map { |line| line.bytesize + 1 }.inject(0, :+)
+    plain_time = transfer_time(lines)
+    compressed_time = transfer_time(compressed)
+    format('%s: %d -> %d bytes (%.0f %%), %.2f s -> %.2f s, %.0f -> %.0f bytes/s',
+      filename, plain_bytes, compressed_bytes, 100.0 * compressed_bytes / plain_bytes,
+      plain_time, compressed_time, plain_bytes / plain_time, plain_bytes / compressed_time)
+  end
+
+  # Estimated seconds to send 'lines', each after a *NEXT request
+  def self.transfer_time lines
+    lines.map { |line| LINE_REQUEST_BYTES + line.bytesize + 1 }.inject(0, :+).to_f / SERIAL_BYTES_PER_SECOND
+  end
+
+  private
+
+  # Replace the keyword at the start of every statement by its token, a REM
+  # takes the rest of the line
+  def compress_statements text
+    parts = []
+    statements = BasicPacker.split_statements(text)
+    statements.each_with_index do |statement, index|
+      statement = statement.sub(/^ +/, '')
+      keyword = BasicPacker.keyword_of(@keywords, statement)
+      unless keyword && statement[keyword.size].to_s =~ /^ ?$/
+        parts << statement
+        next
+      end
+      token = (TRANSFER_TOKEN + @keywords.index(keyword)).chr
+      rest = statement[keyword.size..-1].sub(/^ /, '')
+      if keyword == 'rem'
+        parts << token + ([rest] + statements[index + 1..-1]).join(':')
+        break
+      end
+      parts << token + rest
+    end
+    parts.join(':').b
+  end
+end
+
+if __FILE__ == $0
+  abort 'Usage: bascompress.rb <program.bas> ...' if ARGV.empty?
+  keywords = BasicPacker.keywords
+  ARGV.each { |filename| puts LineCompressor.report(keywords, filename) }
+end
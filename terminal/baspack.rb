@@ -0,0 +1,255 @@
+#!/bin/env ruby
+# encoding: UTF-8
+
+# Pack a BASIC program before it is sent to the homecomputer: remove REM
+# statements and redundant spaces and renumber the lines densely. Jump targets
+# (GOTO, GOSUB, ON ... GOTO/GOSUB, THEN, ONERROR, RESTORE) are rewritten, a
+# jump to a removed line continues at the next remaining line.
+#
+# terminal.rb packs the programs loaded with LOAD if it is started with
+# --pack. A program saved with SAVE afterwards is the packed version, without
+# its comments, so packing is not the default.
+#
+# Usage: baspack.rb <program.bas> > packed.bas
+
+# Size of a program_line node (firmware/basic.h) and of the heap block header
+# of its arguments
+LINE_NODE_BYTES = 8
+HEAP_BLOCK_BYTES = 2
+
+# Rough cycle costs of the interpreter for the savings estimate: fetching and
+# dispatching a line, dispatching a statement and scanning one argument
+# character (strlen/lexer)
+LINE_CYCLES = 200
+STATEMENT_CYCLES = 60
+CHAR_CYCLES = 10
+
+class PackError < StandardError
+end
+
+class BasicPacker
+  attr_reader :lines
+
+  # 'keywords' is the keyword table of the interpreter (the first matching
+  # prefix wins), 'lines' maps line numbers to their text
+  def initialize keywords, lines
+    @keywords = keywords
+    @source = lines.sort.to_h
+    @lines = {}
+  end
+
+  # The keyword table of the interpreter, in the order of the command indices.
+  # bascc.rb, bascompress.rb and firmware/bas2rom.rb use it too.
+  def self.keywords basic_c = File.expand_path('../firmware/basic.c', __dir__)
+    File.read(basic_c)[/const char \*keywords\[\] = \{(.*?)\};/m, 1].scan(/"(\w+)"/).flatten
+  end
+
+  # The keyword a statement starts with, like the interpreter the first
+  # matching prefix in 'keywords' wins (nil if there is none)
+  def self.keyword_of keywords, statement
+    statement = statement.downcase
+    keywords.find { |k| statement.start_with? k }
+  end
+
+  def self.read_program filename
+    lines = {}
+    File.readlines(filename).each_with_index do |line, index|
+      line = line.chomp
+      next if line.strip.empty?
+      raise PackError, "#{filename}:#{index + 1}: Missing line number" unless line =~ /^(\d+) +(.*)$/
+      lines[$1.to_i] = $2
+    end
+    lines
+  end
+
+  def pack
+    kept = {}
+    @source.each do |number, text|
+      statements = strip_comments(text)
+      kept[number] = statements unless statements.empty?
+    end
+
+    # Lines are renumbered 1, 2, 3, ... A removed line maps to the next kept
+    # line, trailing removed lines map to an END line appended if needed
+    numbers = {}
+    new_number = 0
+    kept.each_key { |number| numbers[number] = (new_number += 1) }
+    pending = []
+    @source.each_key do |number|
+      if numbers[number]
+        pending.each { |removed| numbers[removed] = numbers[number] }
+        pending.clear
+      else
+        pending << number
+      end
+    end
+    end_line = new_number + 1
+    pending.each { |removed| numbers[removed] = end_line }
+
+    @numbers = numbers
+    kept.each do |number, statements|
+      @line = number
+      @lines[numbers[number]] = statements.map { |s| rewrite_statement(s) }.join(':')
+    end
+    @lines[end_line] = 'end' if @lines.values.any? { |text| references(text).include? end_line }
+    @lines
+  end
+
+  # Program lines in the file format
+  def to_s
+    @lines.map { |number, text| "#{number} #{text}\n" }.join
+  end
+
+  # Estimated RAM bytes and cycles for one pass through the lines
+  def self.cost keywords, lines
+    bytes = 0
+    cycles = 0
+    lines.each_value do |text|
+      statements = encode(keywords, text)
+      bytes += LINE_NODE_BYTES + HEAP_BLOCK_BYTES + statements.map { |args| args.size + 2 }.inject(0, :+)
+      cycles += LINE_CYCLES + statements.map { |args| STATEMENT_CYCLES + args.size * CHAR_CYCLES }.inject(0, :+)
+    end
+    [bytes, cycles]
+  end
+
+  def report
+    old_bytes, old_cycles = BasicPacker.cost(@keywords, @source)
+    new_bytes, new_cycles = BasicPacker.cost(@keywords, @lines)
+    "#{@source.size} -> #{@lines.size} lines, " +
+      "#{old_bytes} -> #{new_bytes} bytes RAM (#{old_bytes - new_bytes} saved), " +
+      "about #{old_cycles - new_cycles} cycles saved per pass"
+  end
+
+  # The arguments of the statements of a line as the interpreter stores them
+  # (a REM takes the rest of the line)
+  def self.encode keywords, text
+    split_statements(text).each_with_index.map do |statement, index|
+      statement = statement.sub(/^ +/, '')
+      keyword = keyword_of(keywords, statement)
+      if keyword == 'rem'
+        return split_statements(text)[0...index].map { |s| args_of(s) } +
+          [args_of(split_statements(text)[index..-1].join(':'))]
+      end
+      args_of(statement)
+    end
+  end
+
+  def self.args_of statement
+    statement.sub(/^ +/, '').sub(/^\S*/, '').strip
+  end
+
+  # Split a line into its statements at ':' outside of string constants
+  def self.split_statements line
+    statements = ['']
+    in_string = false
+    line.each_char do |c|
+      in_string = !in_string if c == '"'
+      if c == ':' && !in_string
+        statements << ''
+      else
+        statements.last << c
+      end
+    end
+    statements
+  end
+
+  private
+
+  def keyword_of statement
+    BasicPacker.keyword_of(@keywords, statement)
+  end
+
+  # Return the statements of a line without the REM statement (which extends
+  # to the end of the line) and with compacted spaces
+  def strip_comments text
+    statements = []
+    BasicPacker.split_statements(text).each do |statement|
+      statement = compact(statement)
+      break if keyword_of(statement) == 'rem'
+      statements << statement
+    end
+    statements
+  end
+
+  # Statements that end with another statement behind a separator word
+  NESTED_STATEMENTS = { 'if' => /\bthen\b/i, 'input' => /\bonerror\b/i }
+
+  # Remove spaces outside of strings, except the one behind a keyword
+  # (find_args() in basic.c) and those between words
+  def compact statement
+    keyword, args = statement.strip.split(/ +/, 2)
+    return keyword.to_s if args.nil?
+    separator = NESTED_STATEMENTS[keyword_of(statement)]
+    parts = separator && split_at(args, separator)
+    if parts
+      head, word, tail = parts
+      return "#{keyword} #{compact_args(head)} #{word} #{compact(tail)}"
+    end
+    "#{keyword} #{compact_args(args)}"
+  end
+
+  def compact_args args
+    parts = args.split(/("[^"]*"?)/)
+    parts.each_with_index.map do |part, index|
+      index.odd? ? part : part.gsub(/ +/, ' ').gsub(/ *([,=<>!+\-*\/%]) */, '\1')
+    end.join.strip
+  end
+
+  # Split 'text' at the first match of 'separator' outside of strings into
+  # the text before, the match and the text behind it, return nil if not found
+  def split_at text, separator
+    parts = text.split(/("[^"]*"?)/)
+    parts.each_with_index do |part, index|
+      match = separator.match(part) if index.even?
+      next unless match
+      return [parts[0...index].join + match.pre_match, match[0],
+        match.post_match + parts[index + 1..-1].join]
+    end
+    nil
+  end
+
+  # Rewrite the jump targets of a statement. A target that is not a plain
+  # number (e.g. RESTORE <expression>) cannot be renumbered.
+  def rewrite_statement statement
+    keyword = keyword_of(statement)
+    case keyword
+    when 'goto', 'gosub', 'restore', 'task'
+      return statement if keyword == 'restore' && statement.casecmp('restore') == 0
+      match = /^(\S+ +)(\d+)$/.match(statement) or raise PackError, "#{@line}: Target is not a number: #{statement}"
+      "#{match[1]}#{target(match[2])}"
+    when 'on'
+      match = /^(.* go(?:to|sub) +)(\d+(?:,\d+)*)$/i.match(statement) or
+        raise PackError, "#{@line}: Target is not a number: #{statement}"
+      "#{match[1]}#{match[2].split(',').map { |n| target(n) }.join(',')}"
+    when *NESTED_STATEMENTS.keys
+      head, word, tail = split_at(statement, NESTED_STATEMENTS[keyword])
+      word ? "#{head}#{word} #{rewrite_statement(tail.strip)}" : statement
+    else
+      statement
+    end
+  end
+
+  def target number
+    new_number = @numbers[number.to_i]
+    raise PackError, "#{@line}: Line #{number} not found" unless new_number
+    new_number
+  end
+
+  # The line numbers a packed line jumps to
+  def references text
+    text.scan(/(?:goto|gosub|restore|task) +([\d ,]+)/i).flat_map { |list| list[0].split(',').map(&:to_i) }
+  end
+end
+
+if __FILE__ == $0
+  program_file = ARGV[0]
+  abort 'Usage: baspack.rb <program.bas>' unless program_file
+  begin
+    packer = BasicPacker.new BasicPacker.keywords, BasicPacker.read_program(program_file)
+    packer.pack
+  rescue PackError => e
+    abort e.message
+  end
+  print packer.to_s
+  STDERR.puts "#{program_file}: #{packer.report}"
+end
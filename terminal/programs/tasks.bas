@@ -0,0 +1,9 @@
+10 cls
+20 task 200
+30 put "Your name: "
+40 input n$
+50 print "Hello ", n$, "!"
+60 goto 30
+200 at 32, 0
+210 put ti$
+220 goto 200
@@ -2,33 +2,104 @@
 # encoding: UTF-8
 
 require 'serialport'
+require_relative 'baspack'
+require_relative 'bascompress'
+require_relative 'xmodem'
 
-serial = SerialPort.open('/dev/ttyUSB0', 9600)
+# Programs are packed before they are loaded if started with --pack (see
+# baspack.rb), SAVE then writes the packed program
+PACK = ARGV.include?('--pack')
+
+# Program lines are sent compressed if the firmware asks for it (see bascompress.rb)
+COMPRESS = !ARGV.include?('--no-compress')
+
+# The keyboard of the host drives the firmware in console mode (see below)
+CONSOLE = ARGV.include?('--console')
+
+# Held while a command of the firmware (*LOAD, *SAVE, ...) is handled, the
+# keyboard input must not get into its exchange on the serial line
+EXCHANGE = Mutex.new
+
+# The serial device can be given as argument, e.g. a pseudo terminal in tests
+PORT = ARGV.find { |arg| !arg.start_with? '--' } || '/dev/ttyUSB0'
+
+serial = SerialPort.open(PORT, 9600)
 
 trap 'SIGINT' do
   serial.close
 end
 
-def cmd_save serial, filename
+# Print the size, compression and effective speed of a transfer
+def transfer_report text_bytes, sent_bytes, start
+  seconds = Time.now - start
+  puts format("%d bytes in %.2f s (%d bytes sent, %.0f %%), %.0f bytes/s",
+    text_bytes, seconds, sent_bytes, 100.0 * sent_bytes / text_bytes, text_bytes / seconds)
+end
+
+def cmd_save serial, filename, compressed
+  compressor = LineCompressor.new BasicPacker.keywords
+  text_bytes = sent_bytes = 0
+  start = Time.now
   File.open(filename, 'w') do |file|
-    while line = serial.gets.chomp
+    while line = serial.gets.b.chomp
       break if line =~ /\*EOF/
-      file.puts line
+      text = compressed ? compressor.expand(line) : line
+      file.puts text
+      text_bytes += text.bytesize + 1
+      sent_bytes += line.bytesize + 1
       print '.'
     end
   end
   puts "\nSaved program to file #{filename}"
+  transfer_report text_bytes, sent_bytes, start
 end
 
-def cmd_load serial, filename
+# Return the lines of a program file, packed if --pack was given
+def program_lines filename
+  lines = File.readlines(filename)
+  return lines unless PACK
   begin
-    File.open(filename).each do |line|
+    packer = BasicPacker.new BasicPacker.keywords, BasicPacker.read_program(filename)
+    packer.pack
+    puts "Packed #{filename}: #{packer.report}"
+    packer.to_s.lines
+  rescue PackError => e
+    puts "Not packed: #{e.message}"
+    lines
+  end
+end
+
+# Longest line the firmware receives (READLINE_MAX_CHARS in firmware/readline.h)
+# and longest program line it expands a compressed line into (parsebuf)
+MAX_RECEIVED_CHARS = 79
+MAX_LINE_CHARS = 255
+
+def cmd_load serial, filename, compressed
+  begin
+    lines = program_lines(filename).map(&:chomp).reject { |line| line.strip.empty? }
+    compressor = LineCompressor.new BasicPacker.keywords
+    sent = lines.map { |line| compressed ? compressor.compress(line) : line }
+    too_long = lines.zip(sent).find do |line, data|
+      line.bytesize > MAX_LINE_CHARS || data.bytesize > MAX_RECEIVED_CHARS
+    end
+    if too_long
       serial.gets
-      serial.puts line
+      puts "Line too long: #{too_long.first}"
+      serial.puts '!TOOLONG'
+      return
+    end
+    text_bytes = sent_bytes = 0
+    start = Time.now
+    lines.zip(sent).each do |line, data|
+      serial.gets
+      serial.write data + "\n"
+      text_bytes += line.bytesize + 1
+      sent_bytes += data.bytesize + 1
     end
     serial.gets
     serial.puts '*EOF'
     puts "Loaded program from file #{filename}"
+    transfer_report text_bytes, sent_bytes, start
   rescue Errno::ENOENT => x
     serial.gets
     puts "File not found: #{filename}"
@@ -36,6 +107,62 @@ def cmd_load serial, filename
   end
 end
 
+# Number of lines per block of an overlay program (see firmware/overlay.c)
+OVERLAY_BLOCK_LINES = 16
+
+def overlay_blocks filename
+  lines = File.readlines(filename).map(&:chomp).select { |line| line =~ /^\d+ / }
+  lines.sort_by(&:to_i).each_slice(OVERLAY_BLOCK_LINES).to_a
+end
+
+# Send one line per *NEXT request, followed by *EOF
+def send_lines serial, lines
+  lines.each do |line|
+    serial.gets
+    serial.puts line
+  end
+  serial.gets
+  serial.puts '*EOF'
+end
+
+def cmd_overlay serial, filename
+  begin
+    blocks = overlay_blocks filename
+  rescue Errno::ENOENT => x
+    serial.gets
+    puts "File not found: #{filename}"
+    serial.puts '!NOTFOUND'
+    return
+  end
+  send_lines serial, blocks.map { |block| block.first.to_i.to_s }
+  puts "Opened overlay #{filename} with #{blocks.size} blocks"
+end
+
+def cmd_block serial, number, filename
+  send_lines serial, overlay_blocks(filename)[number] || []
+rescue Errno::ENOENT => x
+  serial.gets
+  serial.puts '!NOTFOUND'
+end
+
+def cmd_bload serial, filename
+  begin
+    data = File.binread(filename)
+  rescue Errno::ENOENT => x
+    puts "File not found: #{filename}"
+    serial.puts '!NOTFOUND'
+    return
+  end
+  case xmodem_transfer serial, data
+  when :too_large
+    puts "File too large: #{filename}"
+  when :failed
+    puts "\nTransfer of #{filename} failed"
+  else
+    puts "\nLoaded binary from file #{filename}"
+  end
+end
+
 def cmd_dir serial
   Dir.new('programs').select{|f|f =~ /.+\..+/}.each do |filename|
     line = serial.gets.chomp
@@ -49,18 +176,75 @@ def cmd_dir serial
   serial.puts '*EOF'
 end
 
+# Input events of the firmware (see firmware/replay.c): the file that is
+# recorded and the events that are replayed
+$record_file = nil
+$replay_events = []
+
+def cmd_record filename
+  $record_file.close if $record_file
+  $record_file = File.open(filename, 'w')
+  puts "Recording input events to file #{filename}"
+end
+
+def cmd_record_event event
+  return unless $record_file
+  if event == 'END'
+    $record_file.close
+    $record_file = nil
+    puts 'Recording stopped'
+  else
+    $record_file.puts event
+  end
+end
+
+def cmd_replay serial, filename
+  $replay_events = File.readlines(filename).map(&:chomp)
+  serial.puts '*OK'
+  puts "Replaying #{$replay_events.size} input events from file #{filename}"
+rescue Errno::ENOENT => x
+  puts "File not found: #{filename}"
+  serial.puts '!NOTFOUND'
+end
+
+# Forward the keyboard of the host to the serial line if the firmware runs in
+# console mode (CONSOLE ON or built with CONSOLE=0), start with --console
+Thread.new do
+  while line = STDIN.gets
+    EXCHANGE.synchronize { serial.write line }
+  end
+end if CONSOLE
+
 while true do
   begin
     line = serial.gets.chomp
     puts line.chars.select{|i| i.valid_encoding?}.join
     begin
-      case line
-        when /\*SAVE "((\w|\.| )+)"/
-          cmd_save serial, "programs/#{$1}#{'.bas' unless $1.include? '.'}"
-        when /\*LOAD "((\w|\.| )+)"/
-          cmd_load serial, "programs/#{$1}#{'.bas' unless $1.include? '.'}"
-        when /\*DIR/
-          cmd_dir serial
+      EXCHANGE.synchronize do
+        case line
+          # Checked first, the text of a recorded input line may contain anything.
+          # Console mode may print unterminated output in front of the events.
+          when /\*EV (.*)/
+            cmd_record_event $1
+          when /\*EVENT/
+            serial.puts($replay_events.shift || '*EOF')
+          when /\*SAVE "((\w|\.| )+)"( Z)?/
+            cmd_save serial, "programs/#{$1}#{'.bas' unless $1.include? '.'}", !$3.nil?
+          when /\*BLOAD "((\w|\.| )+)"/
+            cmd_bload serial, "programs/#{$1}#{'.bin' unless $1.include? '.'}"
+          when /\*LOAD "((\w|\.| )+)"( Z)?/
+            cmd_load serial, "programs/#{$1}#{'.bas' unless $1.include? '.'}", COMPRESS && !$3.nil?
+          when /\*OVERLAY "((\w|\.| )+)"/
+            cmd_overlay serial, "programs/#{$1}#{'.bas' unless $1.include? '.'}"
+          when /\*BLOCK (\d+) "((\w|\.| )+)"/
+            cmd_block serial, $1.to_i, "programs/#{$2}#{'.bas' unless $2.include? '.'}"
+          when /\*DIR/
+            cmd_dir serial
+          when /\*RECORD "((\w|\.| )+)"/
+            cmd_record "programs/#{$1}#{'.rec' unless $1.include? '.'}"
+          when /\*REPLAY "((\w|\.| )+)"/
+            cmd_replay serial, "programs/#{$1}#{'.rec' unless $1.include? '.'}"
+        end
       end
     rescue ArgumentError
     end
@@ -0,0 +1,11 @@
+10 rem Integer arithmetic and comparisons
+20 let a = 7
+30 let b = -3
+40 print a + b, " ", a - b, " ", a * b
+50 print a / b, " ", a % b, " ", 100 / 7, " ", 100 % 7
+60 print -100 / 7, " ", -100 % 7, " ", 1000 * 32
+70 print a == 7, " ", a != 7, " ", b < a, " ", b > a
+80 print a <= 7, " ", a >= 8, " ", b <= -4, " ", b >= -3
+90 let c = 32767
+100 let c = c + 1
+110 print c
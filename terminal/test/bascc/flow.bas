@@ -0,0 +1,15 @@
+10 rem GOTO, GOSUB, IF and END
+20 let i = 0
+30 gosub 200
+40 let i = i + 1
+50 if i < 5 then goto 30
+60 print "Done after ", i
+70 if i == 5 then print "Five": gosub 300
+80 end
+90 print "Not reached"
+200 put "i = ", i, " "
+210 if i % 2 == 0 then print "even"
+220 if i % 2 != 0 then print "odd"
+230 return
+300 print "Nested": sleep 100
+310 return
@@ -0,0 +1,15 @@
+10 rem String variables, INPUT, AT and WRITE
+20 put "Your name: "
+30 input n$
+40 let g$ = "Hello "
+50 put g$
+60 print n$, "!"
+70 put "Your age: "
+80 input a
+90 print "Next year you are ", a + 1
+100 let t$ = n$
+110 print t$, t$
+120 at 5, 3
+130 write "x"
+140 at 5, 3, c$
+150 print "At 5, 3: ", c$
@@ -0,0 +1,137 @@
+#!/bin/env ruby
+# encoding: UTF-8
+
+# Correctness test of the cross compiler (see bascc.rb): every test program
+# runs in the interpreter and as compiled code on the homecomputer, the test
+# fails if the outputs differ.
+#
+# The firmware must run in console mode (make clean all CONSOLE=0), so the
+# output and the input lines of the programs go over the serial line, and
+# firmware/firmware.lbl must belong to the running build. The compiled
+# programs are assembled and linked with ca65 and ld65.
+# The input lines of a program are read from <program>.in, they are typed
+# whenever the program stops sending output for INPUT_PAUSE seconds.
+#
+# Usage: bascc_test.rb [<program.bas> ...] (default: test/bascc/*.bas)
+
+require 'serialport'
+require 'tmpdir'
+require 'rbconfig'
+require_relative '../xmodem'
+
+TERMINAL_DIR = File.expand_path('..', __dir__)
+
+# Load address of the compiled programs (see bascc.rb)
+LOAD_ADDRESS = 0x6f00
+
+# Seconds without output after which the next input line is typed
+INPUT_PAUSE = 0.5
+
+# Seconds a program may run
+TIMEOUT = 60
+
+# Printed behind SYS, it marks the end of the output of the compiled program
+END_MARKER = '*END'
+
+class TestError < StandardError
+end
+
+# Compile the program 'filename' into the binary 'binary'
+def compile filename, binary
+  source = binary.sub(/\.bin$/, '.s')
+  object = binary.sub(/\.bin$/, '.o')
+  system(RbConfig.ruby, File.join(TERMINAL_DIR, 'bascc.rb'), filename, out: source) or
+    raise TestError, 'bascc.rb failed'
+  system('ca65', '-o', object, source) or raise TestError, 'ca65 failed'
+  system('ld65', '-C', File.join(TERMINAL_DIR, 'bascc.cfg'), '-S', LOAD_ADDRESS.to_s,
+    '-o', binary, object) or raise TestError, 'ld65 failed'
+end
+
+# Return the received characters or nil after 'seconds' without output
+def receive serial, seconds
+  serial.read_nonblock(256)
+rescue IO::WaitReadable
+  IO.select([serial], nil, nil, seconds) ? retry : nil
+end
+
+# Type the line 'text', every character is sent after the echo of the
+# previous one because the ACIA holds only one received character
+def type serial, text
+  text.each_char do |c|
+    serial.write c
+    raise TestError, 'No echo' unless receive(serial, TIMEOUT)
+  end
+  serial.write "\n"
+  echo = ''
+  echo << receive(serial, TIMEOUT).to_s until echo.include? "\n"
+end
+
+# Return the output up to 'end_mark', the lines in 'inputs' are typed when
+# the output pauses
+def wait_for serial, end_mark, inputs = []
+  inputs = inputs.dup
+  output = ''
+  start = Time.now
+  until output.end_with? end_mark
+    raise TestError, "Timeout waiting for #{end_mark.inspect}" if Time.now - start > TIMEOUT
+    if received = receive(serial, INPUT_PAUSE)
+      output << received
+    elsif inputs.any?
+      line = inputs.shift
+      type serial, line
+      output << line << "\n"
+    end
+  end
+  output.chomp end_mark
+end
+
+# Type the command 'command' and return its output up to 'end_mark'
+def execute serial, command, end_mark, inputs = []
+  type serial, command
+  wait_for serial, end_mark, inputs
+end
+
+# Return the output of the interpreted and the compiled program
+def run_both serial, filename, binary
+  inputs = File.exist?(filename.sub(/\.bas$/, '.in')) ?
+    File.readlines(filename.sub(/\.bas$/, '.in')).map(&:chomp) : []
+  type serial, 'new'
+  File.readlines(filename).map(&:chomp).reject { |line| line.strip.empty? }.each do |line|
+    type serial, line
+  end
+  interpreted = execute(serial, 'run', "Ready.\n", inputs)
+
+  type serial, "bload \"#{File.basename binary, '.bin'}\""
+  line = ''
+  line << receive(serial, TIMEOUT).to_s until line =~ /\*BLOAD ".*"\n/
+  raise TestError, 'BLOAD failed' unless xmodem_transfer(serial, File.binread(binary)) == :ok
+  wait_for serial, "Ready.\n"
+  compiled = execute(serial, "sys #{LOAD_ADDRESS}:print \"#{END_MARKER}\"", "#{END_MARKER}\n", inputs)
+  [interpreted, compiled]
+end
+
+programs = ARGV.empty? ? Dir[File.join(__dir__, 'bascc', '*.bas')].sort : ARGV
+serial = SerialPort.open('/dev/ttyUSB0', 9600)
+failures = 0
+
+Dir.mktmpdir do |dir|
+  programs.each do |filename|
+    begin
+      binary = File.join(dir, 'bascctest.bin')
+      compile filename, binary
+      interpreted, compiled = run_both(serial, filename, binary)
+      if interpreted == compiled
+        puts "\nOK   #{filename}"
+      else
+        failures += 1
+        puts "\nFAIL #{filename}", 'Interpreter:', interpreted, 'Compiled:', compiled
+      end
+    rescue TestError => e
+      failures += 1
+      puts "\nFAIL #{filename}: #{e.message}"
+    end
+  end
+end
+
+puts "#{programs.size - failures} of #{programs.size} programs passed"
+exit failures == 0
@@ -0,0 +1,44 @@
+# encoding: UTF-8
+
+# Test of the line compression of LOAD and SAVE (see bascompress.rb): every
+# line compressed for the firmware must expand to the same line again.
+#
+# Usage: ruby test/bascompress_test.rb
+
+require 'minitest/autorun'
+require_relative '../bascompress'
+
+class BascompressTest < Minitest::Test
+  PROGRAMS_DIR = File.expand_path('../programs', __dir__)
+
+  def setup
+    @compressor = LineCompressor.new BasicPacker.keywords
+    @expander = LineCompressor.new BasicPacker.keywords
+  end
+
+  # Compress and expand the lines in sequence, like LOAD and SAVE do
+  def round_trip lines
+    lines.map { |line| @expander.expand(@compressor.compress(line)) }
+  end
+
+  def test_programs
+    Dir[File.join(PROGRAMS_DIR, '*.bas')].sort.each do |filename|
+      lines = File.readlines(filename).map(&:chomp).reject { |line| line.strip.empty? }
+      assert_equal lines.map(&:rstrip), round_trip(lines).map(&:rstrip), filename
+    end
+  end
+
+  def test_plain_line_sets_the_previous_number
+    lines = ['10 print "a"', "20 print \"\xE1\"", '30 print "c"', '40 print "é"', '50 end']
+    compressed = lines.map { |line| @compressor.compress line }
+    assert_equal lines[1], compressed[1]
+    assert_equal (TRANSFER_TOKEN + 10).chr, compressed[2][0]
+    assert_equal (TRANSFER_TOKEN + 10).chr, compressed[4][0]
+    assert_equal lines.map(&:b), round_trip(lines).map(&:b)
+  end
+
+  def test_line_numbers_beyond_the_delta
+    lines = ['10 goto 1000', '1000 end', '5 print "back"']
+    assert_equal lines, round_trip(lines)
+  end
+end
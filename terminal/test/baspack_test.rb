@@ -0,0 +1,55 @@
+# encoding: UTF-8
+
+# Test of the program packer of LOAD --pack (see baspack.rb).
+#
+# Usage: ruby test/baspack_test.rb
+
+require 'minitest/autorun'
+require_relative '../baspack'
+
+class BaspackTest < Minitest::Test
+  def test_keywords
+    keywords = BasicPacker.keywords
+    assert_equal 'goto', keywords.first
+    assert_operator keywords.index('scroll'), :<, keywords.index('scr')
+    assert_operator keywords.index('memcpy'), :<, keywords.index('mem')
+  end
+
+  def test_keyword_of
+    keywords = BasicPacker.keywords
+    assert_equal 'print', BasicPacker.keyword_of(keywords, 'PRINT "a"')
+    assert_equal 'scroll', BasicPacker.keyword_of(keywords, 'scroll up')
+    assert_equal 'scr', BasicPacker.keyword_of(keywords, 'scr 0,0,c')
+    assert_equal 'memcpy', BasicPacker.keyword_of(keywords, 'memcpy 1,2,3')
+    assert_nil BasicPacker.keyword_of(keywords, 'x = 1')
+  end
+
+  def test_split_statements
+    assert_equal ['print "a:b"', ' let a=1', ''], BasicPacker.split_statements('print "a:b": let a=1:')
+    assert_equal ['put "a"', 'put ":"', 'end'], BasicPacker.split_statements('put "a":put ":":end')
+    assert_equal [''], BasicPacker.split_statements('')
+  end
+
+  def pack lines
+    packer = BasicPacker.new BasicPacker.keywords, lines
+    packer.pack
+    packer.lines
+  end
+
+  def test_jump_targets
+    lines = { 10 => 'rem start', 20 => 'gosub 50', 30 => 'on i goto 20, 50', 40 => 'restore 10',
+      50 => 'if i > 1 then task 20' }
+    assert_equal({ 1 => 'gosub 4', 2 => 'on i goto 1,4', 3 => 'restore 1', 4 => 'if i>1 then task 1' },
+      pack(lines))
+  end
+
+  def test_restore_without_target
+    assert_equal({ 1 => 'restore' }, pack(10 => 'restore'))
+  end
+
+  def test_targets_that_are_not_numbers
+    ['goto 10+i', 'gosub i', 'restore n', 'task 10 * 2', 'on i gosub 10,n', 'if i then restore n'].each do |text|
+      assert_raises(PackError, text) { pack(10 => text) }
+    end
+  end
+end
@@ -0,0 +1,508 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include "acia.h"
+#include "lcd.h"
+#include "keys.h"
+#include "led.h"
+#include "sid.h"
+#include "lexer.h"
+#include "utils.h"
+#include "fastmath.h"
+#include "memory.h"
+#include "interrupt.h"
+#include "xmodem.h"
+#include "autostart.h"
+#include "basic.h"
+#include "readline.h"
+#include "console.h"
+
+/*
+ * Host build of the interpreter (firmware/*.c without main.c and memory.c)
+ * for firmware_test.rb. This file replaces the assembler modules:
+ *
+ * - The keyboard is stdin, every character is one key press.
+ * - The LCD keeps the screen buffer, every printed character is also written
+ *   to stdout.
+ * - The serial line is file descriptor 3 (e.g. a pseudo terminal connected
+ *   to terminal.rb), the ACIA output buffer works like in acia.s65.
+ * - lex() is a C version of lexer.s65.
+ *
+ * The program exits when stdin is closed while it waits for a key. The
+ * interpreter keeps pointers in 16 bit values (lex_value), so the host build
+ * must not be position independent.
+ *
+ * Usage: firmware_host [--console]
+ */
+
+#define SERIAL_FD 3
+#define ACIA_BUFFER_SIZE 64
+#define COLUMNS 40
+#define ROWS 4
+
+unsigned char lcd_mode = 0;
+char lcd_display_data[COLUMNS * ROWS];
+static unsigned char lcd_x = 0;
+static unsigned char lcd_y = 0;
+
+static char acia_buffer[ACIA_BUFFER_SIZE];
+static unsigned char acia_buffer_count = 0;
+
+// Key that is pressed (0 if none) and the key that is pressed next
+static int key_char = 0;
+static int next_key = -1;
+
+unsigned long interrupted = 0;
+unsigned long millis = 0;
+unsigned char jiffies = 0;
+unsigned char seconds = 0;
+unsigned char minutes = 0;
+unsigned char hours = 0;
+
+char *lex_ptr;
+unsigned int lex_value;
+unsigned char lex_token;
+
+int compiled_acc;
+int compiled_arg;
+
+char _USER_START__[1];
+char _USER_SIZE__[1];
+
+const autostart_line autostart_program[] = { { 0, 0, 0 } };
+const unsigned char autostart_run = 0;
+
+static void update_time() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  millis = now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/* Serial line */
+
+void acia_init() {
+}
+
+static void serial_write(const char *s, unsigned int n) {
+  if (write(SERIAL_FD, s, n) < 0) {
+    perror("serial line");
+    exit(2);
+  }
+}
+
+void acia_flush() {
+  if (acia_buffer_count) {
+    serial_write(acia_buffer, acia_buffer_count);
+    acia_buffer_count = 0;
+  }
+}
+
+void acia_buffer_putc(char c) {
+  acia_buffer[acia_buffer_count++] = c;
+  if (c == '\n' || acia_buffer_count == ACIA_BUFFER_SIZE) {
+    acia_flush();
+  }
+}
+
+void acia_putc(char c) {
+  acia_flush();
+  serial_write(&c, 1);
+}
+
+void acia_puts(const char *s) {
+  while (*s) {
+    acia_putc(*s++);
+  }
+}
+
+void acia_put_newline() {
+  acia_putc('\n');
+}
+
+static int serial_read(int timeout) {
+  struct pollfd fd = { SERIAL_FD, POLLIN, 0 };
+  unsigned char c;
+  if (poll(&fd, 1, timeout) <= 0) {
+    return -1;
+  }
+  if (read(SERIAL_FD, &c, 1) != 1) {
+    fprintf(stderr, "serial line closed\n");
+    exit(2);
+  }
+  return c;
+}
+
+char acia_getc() {
+  return serial_read(-1);
+}
+
+int acia_getc_nowait() {
+  return serial_read(0);
+}
+
+int acia_getc_timeout() {
+  return serial_read(1000);
+}
+
+void acia_gets(char *buffer, unsigned char n) {
+  unsigned char length = 0;
+  char c;
+  while ((c = acia_getc()) != '\n') {
+    if (length < n) {
+      buffer[length++] = c;
+    }
+  }
+  buffer[length] = '\0';
+}
+
+unsigned char xmodem_read_packet(unsigned char *packet) {
+  return 0;
+}
+
+unsigned int xmodem_crc(const unsigned char *data) {
+  return 0;
+}
+
+/* LCD */
+
+void lcd_init() {
+  memset(lcd_display_data, ' ', sizeof(lcd_display_data));
+}
+
+void lcd_command(unsigned char cmd) {
+}
+
+void lcd_write(char c) {
+  lcd_display_data[lcd_y * COLUMNS + lcd_x] = c;
+}
+
+void lcd_put_newline() {
+  lcd_putc('\n');
+}
+
+void lcd_putc(char c) {
+  if (lcd_mode & LCD_MODE_SERIAL) {
+    acia_buffer_putc(c);
+  }
+  putchar(c);
+  if (c != '\n') {
+    lcd_write(c);
+    if (++lcd_x < COLUMNS) {
+      return;
+    }
+  }
+  lcd_x = 0;
+  if (lcd_y < ROWS - 1) {
+    ++lcd_y;
+  } else {
+    memmove(lcd_display_data, lcd_display_data + COLUMNS, COLUMNS * (ROWS - 1));
+    memset(lcd_display_data + COLUMNS * (ROWS - 1), ' ', COLUMNS);
+  }
+}
+
+void lcd_puts(const char *s) {
+  while (*s) {
+    lcd_putc(*s++);
+  }
+}
+
+void lcd_goto(unsigned char x, unsigned char y) {
+  lcd_x = x;
+  lcd_y = y;
+}
+
+void lcd_clear() {
+  memset(lcd_display_data, ' ', sizeof(lcd_display_data));
+  lcd_goto(0, 0);
+}
+
+unsigned char lcd_get_x() {
+  return lcd_x;
+}
+
+unsigned char lcd_get_y() {
+  return lcd_y;
+}
+
+unsigned char lcd_getc(unsigned char x, unsigned char y) {
+  return lcd_display_data[y * COLUMNS + x];
+}
+
+void lcd_cursor_on() {
+}
+
+void lcd_cursor_off() {
+}
+
+void lcd_cursor_blink() {
+}
+
+void lcd_refresh() {
+}
+
+void lcd_redraw(unsigned char x, unsigned char y, unsigned char w) {
+}
+
+void lcd_define_char(unsigned char n, const unsigned char *bitmap) {
+}
+
+/* Keyboard, a key is pressed and released for every character on stdin */
+
+void keys_init() {
+}
+
+void keys_update() {
+  struct pollfd fd = { 0, POLLIN, 0 };
+  unsigned char c;
+  update_time();
+  if (key_char) {
+    key_char = 0;
+    return;
+  }
+  if (next_key < 0 && poll(&fd, 1, 1) > 0) {
+    if (read(0, &c, 1) != 1) {
+      fflush(stdout);
+      exit(0);
+    }
+    next_key = c;
+  }
+  if (next_key >= 0) {
+    key_char = next_key;
+    next_key = -1;
+  }
+}
+
+char keys_getc() {
+  return key_char;
+}
+
+unsigned char keys_get_code() {
+  if (! key_char) {
+    return KEY_NONE;
+  }
+  return key_char == '\b' ? KEY_BACKSPACE : KEY_SPACE;
+}
+
+unsigned char keys_get_modifiers() {
+  return 0;
+}
+
+unsigned char keys_read_row(unsigned char row) {
+  return 0xff;
+}
+
+/* Lexer, see lexer.s65 */
+
+static unsigned char is_alnum(char c) {
+  return (c >= '0' && c <= '9') || ((c | 0x20) >= 'a' && (c | 0x20) <= 'z');
+}
+
+/**
+ * Return 1 and set lex_ptr behind the keyword if 's' starts with 'keyword'.
+ */
+static unsigned char match_keyword(const char *s, const char *keyword) {
+  unsigned char i;
+  for (i = 0; keyword[i]; ++i) {
+    if ((s[i] | 0x20) != keyword[i]) {
+      return 0;
+    }
+  }
+  lex_ptr = (char *) s + i;
+  return 1;
+}
+
+unsigned char lex(const char *s) {
+  const char *p;
+  if ((unsigned long) s > 0xffffffffUL) {
+    fprintf(stderr, "lex: text out of the 32 bit address range\n");
+    exit(3);
+  }
+  while (*s == ' ') {
+    ++s;
+  }
+  lex_ptr = (char *) s;
+  switch (*s) {
+  case '\0':
+  case ';':
+    return lex_token = TOKEN_END;
+  case '"':
+    lex_value = (unsigned int) (unsigned long) (s + 1);
+    p = strchr(s + 1, '"');
+    lex_ptr = p ? (char *) p + 1 : NULL;
+    return lex_token = TOKEN_STRING;
+  case '=':
+    lex_ptr += s[1] == '=' ? 2 : 1;
+    return lex_token = s[1] == '=' ? TOKEN_EQUAL : TOKEN_ASSIGN;
+  case '<':
+    lex_ptr += s[1] == '=' ? 2 : 1;
+    return lex_token = s[1] == '=' ? TOKEN_LESSEQUAL : TOKEN_LESS;
+  case '>':
+    lex_ptr += s[1] == '=' ? 2 : 1;
+    return lex_token = s[1] == '=' ? TOKEN_GREATEREQUAL : TOKEN_GREATER;
+  case '!':
+    if (s[1] != '=') {
+      return lex_token = TOKEN_INVALID;
+    }
+    lex_ptr += 2;
+    return lex_token = TOKEN_NOTEQUAL;
+  case '+': ++lex_ptr; return lex_token = TOKEN_PLUS;
+  case '-': ++lex_ptr; return lex_token = TOKEN_MINUS;
+  case '*': ++lex_ptr; return lex_token = TOKEN_MUL;
+  case '/': ++lex_ptr; return lex_token = TOKEN_DIV;
+  case '%': ++lex_ptr; return lex_token = TOKEN_MOD;
+  case ',': ++lex_ptr; return lex_token = TOKEN_COMMA;
+  }
+  if (*s >= '0' && *s <= '9') {
+    lex_value = 0;
+    while (*lex_ptr >= '0' && *lex_ptr <= '9') {
+      lex_value = (lex_value * 10 + *lex_ptr++ - '0') & 0xffff;
+    }
+    return lex_token = TOKEN_DIGITS;
+  }
+  if (! is_alnum(*s)) {
+    return lex_token = TOKEN_INVALID;
+  }
+  if (match_keyword(s, "then")) {
+    return lex_token = TOKEN_THEN;
+  }
+  if (match_keyword(s, "onerror")) {
+    return lex_token = TOKEN_ONERROR;
+  }
+  lex_value = (unsigned char) *lex_ptr++;
+  if (is_alnum(*lex_ptr)) {
+    lex_value = (lex_value << 8) | (unsigned char) *lex_ptr++;
+    while (is_alnum(*lex_ptr)) {
+      ++lex_ptr;
+    }
+  }
+  if (*lex_ptr == '$') {
+    ++lex_ptr;
+    return lex_token = TOKEN_VAR_STRING;
+  }
+  return lex_token = TOKEN_VAR_NUMBER;
+}
+
+/* Math with the 16 bit results of fastmath.s65 */
+
+int math_mul(int a, int b) {
+  return (short) (a * b);
+}
+
+int math_div(int a, int b) {
+  return b ? (short) (a / b) : 0;
+}
+
+int math_mod(int a, int b) {
+  return b ? (short) (a % b) : 0;
+}
+
+int math_rand() {
+  return rand() & 0x7fff;
+}
+
+void math_srand(unsigned int seed) {
+  srand(seed);
+}
+
+void math_seed_sid() {
+}
+
+/* Other hardware and runtime routines */
+
+void led_init() {
+}
+
+void led_set(char state) {
+}
+
+void sid_init() {
+}
+
+unsigned int sid_synth() {
+  return 0;
+}
+
+void delay_ms(unsigned char delay) {
+  usleep(delay * 1000);
+  update_time();
+}
+
+unsigned int time_micros() {
+  update_time();
+  return (unsigned int) (millis * 1000);
+}
+
+unsigned int _heapmemavail() {
+  return 0;
+}
+
+unsigned int mem_heap_free() {
+  return 0;
+}
+
+unsigned int mem_heap_largest_block() {
+  return 0;
+}
+
+unsigned int mem_heap_fragments() {
+  return 0;
+}
+
+unsigned int mem_c_stack_used() {
+  return 0;
+}
+
+unsigned int mem_c_stack_size() {
+  return 0;
+}
+
+unsigned int mem_cpu_stack_used() {
+  return 0;
+}
+
+char *itoa(int value, char *buffer, int radix) {
+  sprintf(buffer, "%d", value);
+  return buffer;
+}
+
+// Compiled programs can't run on the host, COMPILE reports an error
+void compiled_execute(unsigned char *code) {
+  syntax_error_msg("Not supported on the host");
+}
+
+void rt_line() {}
+void rt_command() {}
+void rt_eval() {}
+void rt_builtin() {}
+void rt_if() {}
+void rt_gosub() {}
+void rt_on_goto() {}
+void rt_on_gosub() {}
+void rt_end() {}
+void rt_error() {}
+void rt_line_not_found() {}
+void rt_mul() {}
+void rt_div() {}
+void rt_mod() {}
+void rt_equal() {}
+void rt_notequal() {}
+void rt_less() {}
+void rt_lessequal() {}
+void rt_greater() {}
+void rt_greaterequal() {}
+
+int main(int argc, char **argv) {
+  setvbuf(stdout, NULL, _IOLBF, 0);
+  lcd_init();
+  basic_init();
+  if (argc > 1 && strcmp(argv[1], "--console") == 0) {
+    console_on(0);
+  }
+  for (;;) {
+    interpret(readline(NON_INTERRUPTIBLE));
+  }
+  return 0;
+}
@@ -0,0 +1,131 @@
+# encoding: UTF-8
+
+# Test of the interpreter on the host (see firmware_host.c), in console mode
+# connected to terminal.rb over a pseudo terminal.
+#
+# Usage: ruby test/firmware_test.rb
+
+require 'minitest/autorun'
+require 'fileutils'
+require_relative 'pty_helper'
+
+class FirmwareTest < Minitest::Test
+  include PtyHelper
+
+  # Build firmware_host once for all tests
+  def self.host
+    @host ||= PtyHelper.build('firmware_host.c',
+      Dir.chdir(PtyHelper::FIRMWARE_DIR) { Dir['*.c'] - ['main.c', 'memory.c'] }, '-no-pie')
+  end
+
+  def setup
+    @dir = Dir.mktmpdir
+    FileUtils.mkdir File.join(@dir, 'programs')
+  end
+
+  def teardown
+    FileUtils.rm_rf @dir
+  end
+
+  # Type 'lines' on the keyboard of firmware_host and return its output
+  def run_host lines
+    IO.popen([self.class.host, 3 => File::NULL], 'r+') do |host|
+      host.write lines.map { |line| line + "\n" }.join
+      host.close_write
+      Timeout.timeout(10) { host.read }
+    end
+  end
+
+  # Run firmware_host in console mode with terminal.rb (started with the
+  # options 'args'). 'steps' are pairs of a line written to the keyboard of
+  # terminal.rb and the pattern its output must match before the next step:
+  # a line typed during a LOAD or SAVE would be taken for program data.
+  def console steps, args = []
+    input, keyboard = IO.pipe
+    output, writer = IO.pipe
+    keys, key_writer = IO.pipe
+    master, slave, terminal = start_terminal(@dir, ['--console'] + args, in: input, out: writer)
+    host = spawn(self.class.host, '--console', in: keys, out: File::NULL, 3 => master)
+    [input, writer, keys].each(&:close)
+    steps.each do |line, pattern|
+      keyboard.puts line
+      read_until output, pattern
+    end
+  ensure
+    Process.kill 'KILL', host if host
+    Process.wait host if host
+    stop_terminal master, slave, terminal
+    [keyboard, output, key_writer].each { |io| io.close if io && !io.closed? }
+  end
+
+  def test_save_in_console_mode
+    program = ['10 let i = 1', '20 print i', '30 let i = i + 1', '40 if i < 4 then goto 20']
+    console program.map { |line| [line, /#{Regexp.escape line}\n/] } + [['save "out"', /Saved program to file/]]
+    assert_equal program, File.readlines(program_file('out.bas')).map(&:chomp)
+  end
+
+  def program_file name
+    File.join(@dir, 'programs', name)
+  end
+
+  def test_load_and_save_keep_comments
+    program = ['10 rem count to three', '20 let i = 1', '30 print i', '40 let i = i + 1', '50 if i < 4 then goto 30']
+    File.write(program_file('in.bas'), program.join("\n") + "\n")
+    console [['load "in"', /Loaded program/], ['save "out"', /Saved program to file/]]
+    assert_equal program, File.readlines(program_file('out.bas')).map(&:chomp)
+  end
+
+  def test_load_packed
+    program = ['10 rem count to three', '20 let i = 1', '30 print i', '40 let i = i + 1', '50 if i < 4 then goto 30']
+    File.write(program_file('in.bas'), program.join("\n") + "\n")
+    console [['load "in"', /Loaded program/], ['save "out"', /Saved program to file/]], ['--pack']
+    assert_equal ['1 let i=1', '2 print i', '3 let i=i+1', '4 if i<4 then goto 2'],
+      File.readlines(program_file('out.bas')).map(&:chomp)
+  end
+
+  def test_regions_with_large_coordinates
+    lines = ['fill 32767,0,1,1,65', 'fill 0,32767,1,1,65', 'fill 1,0,32767,1,65', 'fill 0,1,1,32767,65',
+      'copy 0,0,1,1,32767,0', 'scroll up 32767,0,1,1', 'scr 32767,0,c']
+    output = run_host(lines)
+    assert_equal lines.size, output.scan('Invalid argument!').size, output
+  end
+
+  def test_new_keeps_the_builtin_variables
+    output = run_host(['let a$ = "text"', 'new', 'print ti$', 'print "ok"'])
+    assert_match(/^ok$/, output)
+  end
+
+  def test_gosub_in_direct_mode
+    output = run_host(['10 print "sub"', '20 return', 'gosub 10', 'on 1 gosub 10', 'if 1 then gosub 10'])
+    assert_equal 3, output.scan('Not in direct mode!').size, output
+    refute_match(/^sub$/, output)
+  end
+
+  def test_main_program_runs_while_a_task_waits_for_input
+    program = ['10 task 100', '20 let i = 0', '30 let i = i + 1', '40 if i < 100 then goto 30',
+      '50 print "main done"', '60 goto 60', '100 input a$', '110 print "got ", a$']
+    # The program does not end, it is stopped in any case
+    IO.popen([self.class.host, 3 => File::NULL], 'r+') do |host|
+      begin
+        host.write((program + ['run']).map { |line| line + "\n" }.join)
+        read_until host, /^main done$/
+        host.write "abc\n"
+        read_until host, /^got abc$/
+      ensure
+        Process.kill 'KILL', host.pid
+      end
+    end
+  end
+
+  def test_memory_statistics_do_not_take_variable_names
+    output = run_host(['let score = 5', 'let mf = 6', 'print score + mf', '10 rem', 'mem 3, p', 'print p', 'mem 10, p'])
+    assert_match(/^11$/, output)
+    assert_match(/^\d+$/, output.lines[output.lines.index("print p\n") + 1])
+    assert_match(/^Invalid argument!$/, output)
+  end
+
+  def test_run_prints_ready
+    output = run_host(['10 print "one"', '20 print "two"', 'run'])
+    assert_equal "one\ntwo\nReady.\n", output.split("run\n").last
+  end
+end
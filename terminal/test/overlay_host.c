@@ -0,0 +1,200 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "acia.h"
+#include "readline.h"
+#include "basic.h"
+#include "overlay.h"
+
+/*
+ * Host build of firmware/overlay.c for overlay_test.rb. The serial line is
+ * stdin (a pseudo terminal connected to terminal.rb). The program lines are
+ * kept in a plain list and run by a small interpreter that knows PRINT,
+ * GOTO, GOSUB, RETURN, ON ... GOTO/GOSUB, END and REM (one statement per
+ * line). The output, the requested blocks and the errors are printed on
+ * stdout.
+ *
+ * Usage: overlay_host <program>
+ */
+
+#define GOSUB_STACK_SIZE 8
+
+char readline_buffer[READLINE_MAX_CHARS + 1];
+char print_buffer[80];
+program_line *program = NULL;
+program_line *current_line = NULL;
+unsigned char error = 0;
+
+static program_line *gosub_stack[GOSUB_STACK_SIZE];
+static unsigned char gosub_depth = 0;
+
+void acia_puts(const char *s) {
+  if (strncmp(s, "*BLOCK ", 7) == 0) {
+    printf("fetch %s\n", s + 7);
+  }
+  write(0, s, strlen(s));
+}
+
+void acia_gets(char *buffer, unsigned char n) {
+  unsigned char length = 0;
+  char c;
+  for (;;) {
+    if (read(0, &c, 1) != 1) {
+      printf("error: serial line closed\n");
+      exit(2);
+    }
+    if (c == '\n') {
+      break;
+    }
+    if (length < n) {
+      buffer[length++] = c;
+    }
+  }
+  buffer[length] = '\0';
+}
+
+void syntax_error_msg_with_arg(const char *msg, const char *msg_arg) {
+  error = 1;
+  printf("error: %s%s\n", msg, msg_arg ? msg_arg : "");
+}
+
+char *skip_whitespace(char *s) {
+  while (*s == ' ') {
+    ++s;
+  }
+  return s;
+}
+
+program_line *find_line(unsigned int number) {
+  program_line *line;
+  if (overlay_blocks && ! overlay_load(number)) {
+    return NULL;
+  }
+  for (line = program; line && line->number != number; line = line->next) {
+  }
+  return line;
+}
+
+void delete_line(unsigned int number) {
+  program_line **link = &program;
+  program_line *line;
+  while ((line = *link) && line->number != number) {
+    link = &line->next;
+  }
+  if (line) {
+    *link = line->next;
+    free(line->args);
+    free(line);
+  }
+}
+
+void create_line(unsigned int number, char *s) {
+  program_line **link = &program;
+  program_line *line = malloc(sizeof(program_line));
+  delete_line(number);
+  while (*link && (*link)->number < number) {
+    link = &(*link)->next;
+  }
+  line->number = number;
+  line->args = strdup(s);
+  line->next = *link;
+  *link = line;
+}
+
+unsigned char line_in_use(unsigned int first, unsigned int last) {
+  unsigned char i;
+  if (current_line && current_line->number >= first && current_line->number <= last) {
+    return 1;
+  }
+  for (i = 0; i < gosub_depth; ++i) {
+    if (gosub_stack[i]->number >= first && gosub_stack[i]->number <= last) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * Return 1 if 'line' is still in the program list.
+ */
+static unsigned char in_program(program_line *line) {
+  program_line *l;
+  for (l = program; l && l != line; l = l->next) {
+  }
+  return l != NULL;
+}
+
+/**
+ * Jump to the line 'number', push the current line first if 'gosub' is true.
+ * Return the target line or NULL with an error.
+ */
+static program_line *jump(unsigned int number, unsigned char gosub) {
+  program_line *line = find_line(number);
+  if (! line) {
+    if (! error) {
+      syntax_error_msg("Line not found");
+    }
+    return NULL;
+  }
+  if (gosub) {
+    gosub_stack[gosub_depth++] = current_line;
+  }
+  return line;
+}
+
+/**
+ * Execute the current line, return the next line to execute.
+ */
+static program_line *execute_line() {
+  char *s = current_line->args;
+  unsigned int number;
+  int index;
+  char kind[6];
+  int offset;
+
+  if (strncmp(s, "print ", 6) == 0) {
+    s = skip_whitespace(s + 6);
+    printf("%.*s\n", (int) strcspn(s + 1, "\""), s + 1);
+  } else if (sscanf(s, "goto %u", &number) == 1) {
+    return jump(number, 0);
+  } else if (sscanf(s, "gosub %u", &number) == 1) {
+    return jump(number, 1);
+  } else if (strcmp(s, "return") == 0) {
+    if (! in_program(gosub_stack[--gosub_depth])) {
+      syntax_error_msg("Return line was evicted");
+      return NULL;
+    }
+    return overlay_next_line(gosub_stack[gosub_depth]);
+  } else if (sscanf(s, "on %d %5s %n", &index, kind, &offset) == 2) {
+    for (s += offset; --index > 0 && (s = strchr(s, ',')); ++s) {
+    }
+    if (index == 0 && s && sscanf(s, "%u", &number) == 1) {
+      return jump(number, strcmp(kind, "gosub") == 0);
+    }
+  } else if (strcmp(s, "end") == 0) {
+    return NULL;
+  } else if (strncmp(s, "rem", 3) != 0) {
+    syntax_error_msg("Syntax error");
+    return NULL;
+  }
+  return overlay_next_line(current_line);
+}
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    fprintf(stderr, "Usage: overlay_host <program>\n");
+    return 1;
+  }
+  setvbuf(stdout, NULL, _IOLBF, 0);
+  if (! overlay_open(argv[1])) {
+    return 1;
+  }
+  printf("%u blocks\n", overlay_blocks);
+  current_line = overlay_first_line();
+  while (current_line && ! error) {
+    current_line = execute_line();
+  }
+  printf("hits %u misses %u\n", overlay_hits, overlay_misses);
+  return error;
+}
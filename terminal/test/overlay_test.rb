@@ -0,0 +1,96 @@
+# encoding: UTF-8
+
+# Test of the overlay protocol (*OVERLAY, *BLOCK, *NEXT): firmware/overlay.c,
+# built for the host with overlay_host.c, and terminal.rb talk over a pseudo
+# terminal. The test programs have 6 blocks of 16 lines, block n starts with
+# line 160 * n + 10, 4 blocks fit into the cache.
+#
+# Usage: ruby test/overlay_test.rb (needs a C compiler, CC=... to choose it)
+
+require 'minitest/autorun'
+require 'fileutils'
+require_relative 'pty_helper'
+
+class OverlayTest < Minitest::Test
+  include PtyHelper
+
+  BLOCKS = 6
+
+  # Build overlay_host once for all tests
+  def self.host
+    @host ||= PtyHelper.build('overlay_host.c', ['overlay.c'])
+  end
+
+  def setup
+    @dir = Dir.mktmpdir
+    Dir.mkdir File.join(@dir, 'programs')
+  end
+
+  def teardown
+    FileUtils.remove_entry @dir
+  end
+
+  # Run the program with the 'statements' (line number => statement, the
+  # other lines are REMs) in overlay mode and return the output of the host
+  def run_overlay statements
+    lines = (1..BLOCKS * 16).map { |n| "#{n * 10} #{statements[n * 10] || 'rem'}" }
+    File.write(File.join(@dir, 'programs', 'test.bas'), lines.join("\n") + "\n")
+    master, slave, terminal = start_terminal(@dir, [], in: File::NULL, out: File::NULL)
+    output, writer = IO.pipe
+    host = spawn(self.class.host, 'test', in: master, out: writer)
+    writer.close
+    Timeout.timeout(30) { Process.wait host }
+    output.read.lines.map(&:chomp)
+  ensure
+    stop_terminal master, slave, terminal
+    output.close if output
+  end
+
+  def test_least_recently_used_block_is_evicted
+    output = run_overlay(
+      10 => 'print "start"',
+      20 => 'gosub 170',
+      30 => 'gosub 330',
+      40 => 'gosub 490',
+      50 => 'gosub 180',  # Block 1 becomes the most recently used one
+      60 => 'gosub 650',  # Block 4 replaces block 2
+      70 => 'gosub 340',  # Block 2 replaces block 3
+      80 => 'end',
+      170 => 'print "block 1"', 180 => 'return',
+      330 => 'print "block 2"', 340 => 'return',
+      490 => 'print "block 3"', 500 => 'return',
+      650 => 'print "block 4"', 660 => 'return')
+    assert_equal ['6 blocks', 'fetch 0', 'start', 'fetch 1', 'block 1', 'fetch 2', 'block 2',
+      'fetch 3', 'block 3', 'fetch 4', 'block 4', 'fetch 2', 'hits 1 misses 6'], output
+  end
+
+  def test_cache_full_when_all_blocks_are_in_use
+    output = run_overlay(
+      10 => 'gosub 170',
+      170 => 'gosub 330',
+      330 => 'gosub 490',
+      490 => 'gosub 650',
+      650 => 'print "not reached"')
+    assert_equal ['6 blocks', 'fetch 0', 'fetch 1', 'fetch 2', 'fetch 3', 'error: Overlay cache full',
+      'hits 0 misses 5'], output
+  end
+
+  def test_on_goto_and_gosub_across_blocks
+    output = run_overlay(
+      10 => 'print "on"',
+      20 => 'on 3 gosub 30,40,650',
+      30 => 'on 2 goto 40,330',
+      40 => 'print "wrong target"',
+      50 => 'on 5 gosub 170',      # Out of range, continues with the next line
+      60 => 'on 1 gosub 170',      # Block 1 replaces block 4
+      70 => 'on 1 gosub 670',      # Block 4 replaces block 3
+      80 => 'print "end"',
+      90 => 'end',
+      170 => 'print "block 1"', 180 => 'return',
+      330 => 'print "block 2"', 340 => 'on 1 goto 50',
+      490 => 'print "block 3"', 500 => 'return',
+      650 => 'print "block 4"', 660 => 'on 1 gosub 490,170', 670 => 'return')
+    assert_equal ['6 blocks', 'fetch 0', 'on', 'fetch 4', 'block 4', 'fetch 3', 'block 3',
+      'fetch 2', 'block 2', 'fetch 1', 'block 1', 'fetch 4', 'end', 'hits 1 misses 6'], output
+  end
+end
@@ -0,0 +1,55 @@
+# encoding: UTF-8
+
+# Helpers of the tests that connect a host build of the firmware and
+# terminal.rb over a pseudo terminal.
+
+require 'pty'
+require 'io/console'
+require 'tmpdir'
+require 'timeout'
+require 'rbconfig'
+
+module PtyHelper
+  FIRMWARE_DIR = File.expand_path('../../firmware', __dir__)
+  TERMINAL = File.expand_path('../terminal.rb', __dir__)
+
+  # Compile the C 'sources' (relative to the firmware directory) with the test
+  # harness 'harness' and return the path of the program
+  def self.build harness, sources, *flags
+    program = File.join(Dir.mktmpdir, File.basename(harness, '.c'))
+    system(ENV['CC'] || 'cc', '-w', '-D__fastcall__=', "-I#{FIRMWARE_DIR}", *flags, '-o', program,
+      File.join(__dir__, harness), *sources.map { |source| File.join(FIRMWARE_DIR, source) }) or
+      raise "Building #{harness} failed"
+    program
+  end
+
+  # Start terminal.rb in 'dir' with the options 'args' on a new pseudo
+  # terminal, 'redirects' are passed to spawn. Return the master side of the
+  # pseudo terminal, the slave side and the process id of terminal.rb. The
+  # output of terminal.rb is not buffered so that it can be read from a pipe.
+  def start_terminal dir, args, redirects
+    master, slave = PTY.open
+    slave.raw!
+    terminal = spawn(RbConfig.ruby, '-I', __dir__, '-e', 'STDOUT.sync = true; load ARGV.shift',
+      TERMINAL, *args, slave.path, { chdir: dir }.merge(redirects))
+    [master, slave, terminal]
+  end
+
+  # Stop terminal.rb and close the pseudo terminal
+  def stop_terminal master, slave, terminal
+    Process.kill 'KILL', terminal if terminal
+    Process.wait terminal if terminal
+    [master, slave].each { |io| io.close if io && !io.closed? }
+  end
+
+  # Read from 'io' until the text read matches 'pattern' and return the text
+  def read_until io, pattern, seconds = 10
+    text = ''
+    Timeout.timeout(seconds) do
+      text << io.readpartial(256) until text =~ pattern
+    end
+    text
+  rescue Timeout::Error
+    flunk "Timeout waiting for #{pattern.inspect}, received #{text.inspect}"
+  end
+end
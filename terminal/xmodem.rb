@@ -0,0 +1,52 @@
+# encoding: UTF-8
+
+# Sender side of the XMODEM-CRC transfer of BLOAD (see firmware/xmodem.c)
+
+SOH = 0x01
+EOT = 0x04
+ACK = 0x06
+NAK = 0x15
+CAN = 0x18
+
+def xmodem_crc data
+  data.inject(0) do |crc, byte|
+    crc ^= byte << 8
+    8.times { crc = (crc & 0x8000) != 0 ? ((crc << 1) ^ 0x1021) & 0xffff : (crc << 1) & 0xffff }
+    crc
+  end
+end
+
+# Wait for the receiver to request the next packet, return ACK, NAK, 'C' or CAN
+def xmodem_response serial
+  while byte = serial.getbyte
+    return byte if [ACK, NAK, CAN, 'C'.ord].include? byte
+  end
+end
+
+# Send a packet until the receiver acknowledges it, return false on failure
+def xmodem_send serial, packet
+  10.times do
+    serial.write packet.pack('C*')
+    response = xmodem_response serial
+    return true if response == ACK
+    return false if response == CAN
+  end
+  false
+end
+
+# Announce 'data' with *XMODEM <size> and send it in 128 byte packets. Return
+# :ok, :too_large if the receiver cancels at once or :failed.
+def xmodem_transfer serial, data
+  serial.puts "*XMODEM #{data.size}"
+  return :too_large if xmodem_response(serial) == CAN
+  data.bytes.each_slice(128).each_with_index do |block, index|
+    block += [0x1a] * (128 - block.size)
+    number = (index + 1) & 0xff
+    crc = xmodem_crc block
+    return :failed unless xmodem_send serial, [SOH, number, 255 - number] + block + [crc >> 8, crc & 0xff]
+    print '.'
+  end
+  serial.putc EOT
+  xmodem_response serial
+  :ok
+end